@@ -0,0 +1,74 @@
+#include "allocationCounter.h"
+
+#include <cstdlib>
+
+namespace
+{
+thread_local AllocationCounter *activeCounter = nullptr;
+thread_local quint64 *activeCount = nullptr;
+}
+
+AllocationCounter::AllocationCounter()
+    : previous(activeCounter)
+{
+    activeCounter = this;
+    activeCount = &allocations;
+}
+
+AllocationCounter::~AllocationCounter()
+{
+    activeCounter = previous;
+    activeCount = previous ? &previous->allocations : nullptr;
+}
+
+quint64 AllocationCounter::count() const
+{
+    return allocations;
+}
+
+#if defined(__GLIBC__)
+
+// operator new goes through malloc too, and so does QArrayData
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+
+void *malloc(size_t size) noexcept
+{
+    if (activeCount) {
+        ++*activeCount;
+    }
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) noexcept
+{
+    if (activeCount) {
+        ++*activeCount;
+    }
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size) noexcept
+{
+    if (activeCount) {
+        ++*activeCount;
+    }
+    return __libc_realloc(ptr, size);
+}
+}
+
+bool AllocationCounter::isSupported()
+{
+    return true;
+}
+
+#else
+
+bool AllocationCounter::isSupported()
+{
+    return false;
+}
+
+#endif
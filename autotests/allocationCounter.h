@@ -0,0 +1,20 @@
+#pragma once
+
+#include <QtGlobal>
+
+// Counts the heap allocations made by the current thread while it's alive.
+// Only glibc lets the test binary interpose malloc, isSupported() is false elsewhere.
+class AllocationCounter
+{
+public:
+    AllocationCounter();
+    ~AllocationCounter();
+
+    quint64 count() const;
+
+    static bool isSupported();
+
+private:
+    quint64 allocations = 0;
+    AllocationCounter *previous;
+};
@@ -0,0 +1,404 @@
+#include "allocationCounter.h"
+#include "exportJob.h"
+#include "kolorExporter.h"
+#include "schemeBatch.h"
+#include "shadeRamp.h"
+#include "targetRegistry.h"
+
+#include <QDir>
+#include <QSignalSpy>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include <KConfigGroup>
+
+#include <vector>
+
+// Timings for each stage of an export, and for a whole one through the module.
+// Run with -tickcounter or -callgrind for steadier numbers.
+class ExportBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void benchmarkColorSchemeSet();
+    void benchmarkKdePalette();
+    void benchmarkDiscordPalette();
+    void benchmarkRampPalette();
+    void benchmarkAccentUpdate();
+    void benchmarkShadeRamp_data();
+    void benchmarkShadeRamp();
+    void benchmarkRender_data();
+    void benchmarkRender();
+    void benchmarkWriteUnchanged();
+    void benchmarkWriteChanged();
+    void benchmarkSetColors_data();
+    void benchmarkSetColors();
+    void benchmarkSchemeBatchCold();
+    void benchmarkSchemeBatchWarm();
+    void reportAllocations();
+    void cleanupTestCase();
+
+private:
+    // an export of the module, from setColors() until the job is done. False if it
+    // was cancelled or a target failed, a failed write is no use as a timing
+    bool runSetColors();
+    // like picking another accent color, the next setColors() is an incremental export
+    void changeAccent();
+    quint64 failedWrites() const;
+    void runSchemeBatch(SchemeBatch &batch);
+
+    QTemporaryDir home;
+    // the fixture, for the benchmarks of a single stage
+    KSharedConfigPtr kdeglobals;
+    // the sandbox's kdeglobals, what the module reads
+    KSharedConfigPtr sessionConfig;
+    std::unique_ptr<kolorExporter> module;
+    bool accentToggle = false;
+    QList<ExportTarget> targets;
+    QStringList schemes;
+    SchemeExportSettings schemeSettings;
+};
+
+void ExportBenchmark::initTestCase()
+{
+    QVERIFY(home.isValid());
+    qputenv("HOME", QFile::encodeName(home.path()));
+    // the module would replace the session's socket otherwise
+    const QString runtimeDir = home.filePath(QStringLiteral("runtime"));
+    QVERIFY(QDir().mkpath(runtimeDir));
+    QVERIFY(QFile::setPermissions(runtimeDir, QFile::ReadOwner | QFile::WriteOwner | QFile::ExeOwner));
+    qputenv("XDG_RUNTIME_DIR", QFile::encodeName(runtimeDir));
+    QStandardPaths::setTestModeEnabled(true);
+
+    const QString configDir = QStandardPaths::writableLocation(QStandardPaths::GenericConfigLocation);
+    const QString dataDir = QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation);
+    QDir(configDir).removeRecursively();
+    QDir(dataDir).removeRecursively();
+    QDir(QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)).removeRecursively();
+    QVERIFY(QDir().mkpath(dataDir + QStringLiteral("/rofi/themes")));
+    QVERIFY(QDir().mkpath(configDir + QStringLiteral("/Vencord")));
+
+    kdeglobals = KSharedConfig::openConfig(QFINDTESTDATA("data/kdeglobals"), KConfig::SimpleConfig);
+    TargetRegistry registry;
+    registry.setTargets(loadExportTargets(KSharedConfig::openConfig(home.filePath(QStringLiteral("kolorexporterrc")), KConfig::SimpleConfig)));
+    targets = registry.availableTargets();
+
+    // about as many as a system with a few scheme packs installed has
+    const QString schemeDir = home.filePath(QStringLiteral("color-schemes"));
+    QVERIFY(QDir().mkpath(schemeDir));
+    for (int i = 0; i < 300; i++) {
+        const QString scheme = schemeDir + QStringLiteral("/Scheme%1.colors").arg(i);
+        QVERIFY(QFile::copy(QFINDTESTDATA("data/kdeglobals"), scheme));
+        QVERIFY(QFile::setPermissions(scheme, QFile::ReadOwner | QFile::WriteOwner));
+        KConfig config(scheme, KConfig::SimpleConfig);
+        config.group(QStringLiteral("Colors:View")).writeEntry("BackgroundNormal", QStringLiteral("%1,%2,%3").arg(i % 256).arg(i / 2).arg(255 - i % 256));
+        QVERIFY(config.sync());
+    }
+    schemes = SchemeBatch::findSchemes({schemeDir});
+    schemeSettings.palette = KdePalette;
+    for (const ExportTarget &target : std::as_const(targets)) {
+        schemeSettings.templates.append(std::pair(target.name, target.outputTemplate));
+    }
+
+    // the startup export writes everything, the benchmarks measure the steady state after it
+    QVERIFY(QFile::copy(QFINDTESTDATA("data/kdeglobals"), configDir + QStringLiteral("/kdeglobals")));
+    sessionConfig = KSharedConfig::openConfig();
+    module = std::make_unique<kolorExporter>(nullptr, QVariantList());
+    QSignalSpy finished(module.get(), &kolorExporter::exportFinished);
+    QVERIFY(finished.wait(30000));
+    QCOMPARE(failedWrites(), quint64(0));
+}
+
+bool ExportBenchmark::runSetColors()
+{
+    const quint64 failed = failedWrites();
+    QSignalSpy finished(module.get(), &kolorExporter::exportFinished);
+    // runs a pending export right away, or checks every target if there's none
+    module->exportNow();
+    if (!finished.wait(30000) || finished.constLast().at(1).toBool()) {
+        return false;
+    }
+    return failedWrites() == failed;
+}
+
+void ExportBenchmark::changeAccent()
+{
+    // alternates, so every round changes the colors
+    accentToggle = !accentToggle;
+    const ConfigChangeEvent event{0,
+                                  {QStringLiteral("General")},
+                                  {QByteArrayLiteral("AccentColor")},
+                                  {accentToggle ? QStringLiteral("233,84,32") : QStringLiteral("61,174,233")}};
+    const KConfigGroup group = event.apply(*sessionConfig, KConfig::Global);
+    QVERIFY(sessionConfig->sync());
+    module->onKdeglobalsSettingsChange(group, event.names);
+}
+
+quint64 ExportBenchmark::failedWrites() const
+{
+    quint64 failed = 0;
+    const QVariantMap targetStats = module->metrics().value(QStringLiteral("targets")).toMap();
+    for (const QVariant &stats : targetStats) {
+        failed += stats.toMap().value(QStringLiteral("failed")).toULongLong();
+    }
+    return failed;
+}
+
+void ExportBenchmark::runSchemeBatch(SchemeBatch &batch)
+{
+    QSignalSpy finished(&batch, &SchemeBatch::finished);
+    batch.start(schemeSettings, schemes);
+    QVERIFY(finished.wait(60000));
+}
+
+void ExportBenchmark::benchmarkColorSchemeSet()
+{
+    QBENCHMARK {
+        const ColorSchemeSet schemes(kdeglobals);
+        Q_UNUSED(schemes);
+    }
+}
+
+void ExportBenchmark::benchmarkKdePalette()
+{
+    const ColorSchemeSet schemes(kdeglobals);
+    Palette palette;
+    QBENCHMARK {
+        palette = computeKdePalette(schemes);
+    }
+    QCOMPARE(palette.size(), qsizetype(84));
+}
+
+void ExportBenchmark::benchmarkDiscordPalette()
+{
+    const ColorSchemeSet schemes(kdeglobals);
+    Palette palette;
+    QBENCHMARK {
+        palette = computeDiscordPalette(schemes);
+    }
+    QCOMPARE(palette.size(), qsizetype(74));
+}
+
+void ExportBenchmark::benchmarkRampPalette()
+{
+    const ColorSchemeSet schemes(kdeglobals);
+    Palette palette;
+    QBENCHMARK {
+        palette = computeRampPalette(schemes, RampSettings());
+    }
+    QCOMPARE(palette.size(), qsizetype(110));
+}
+
+// what an accent change recomputes, compare with the three palettes above
+void ExportBenchmark::benchmarkAccentUpdate()
+{
+    const ColorSchemeSet schemes(kdeglobals);
+    std::array<Palette, PaletteCount> palettes;
+    int recomputed = 0;
+    for (int id = 0; id < PaletteCount; id++) {
+        recomputed += updatePalette(PaletteId(id), schemes, RampSettings(), 0, palettes[id]);
+    }
+    qInfo() << "Full update:" << recomputed << "colors";
+
+    QBENCHMARK {
+        recomputed = 0;
+        for (int id = 0; id < PaletteCount; id++) {
+            recomputed += updatePalette(PaletteId(id), schemes, RampSettings(), AccentColorInput, palettes[id]);
+        }
+    }
+    qInfo() << "Accent update:" << recomputed << "colors";
+}
+
+void ExportBenchmark::benchmarkShadeRamp_data()
+{
+    QTest::addColumn<QString>("method");
+    QTest::addColumn<int>("stops");
+
+    // 27 is what a discord ramp has
+    for (int stops : {27, 270}) {
+        QTest::addRow("QColor::fromHsl, %d stops", stops) << QStringLiteral("qcolor") << stops;
+        QTest::addRow("hsl, %d stops", stops) << QStringLiteral("hsl") << stops;
+        QTest::addRow("oklch, %d stops", stops) << QStringLiteral("oklch") << stops;
+    }
+}
+
+void ExportBenchmark::benchmarkShadeRamp()
+{
+    QFETCH(QString, method);
+    QFETCH(int, stops);
+
+    const QColor base(61, 174, 233);
+    std::vector<float> lightness(stops);
+    std::vector<int> lightness8(stops);
+    for (int i = 0; i < stops; i++) {
+        lightness8[i] = 255 - 255 * i / (stops - 1);
+        lightness[i] = lightness8[i] / 255.f;
+    }
+    std::vector<QRgb> shades(stops);
+
+    if (method == QStringLiteral("qcolor")) {
+        // how the discord ramps were computed before ShadeRamp
+        QBENCHMARK {
+            const int hue = base.hslHue();
+            const int saturation = base.hslSaturation();
+            for (int i = 0; i < stops; i++) {
+                shades[i] = QColor::fromHsl(hue, saturation, lightness8[i]).rgb();
+            }
+        }
+    } else {
+        const ShadeRamp::Space space = method == QStringLiteral("hsl") ? ShadeRamp::Hsl : ShadeRamp::Oklch;
+        QBENCHMARK {
+            ShadeRamp(space, base).generate(lightness, shades);
+        }
+    }
+}
+
+void ExportBenchmark::benchmarkRender_data()
+{
+    QTest::addColumn<int>("target");
+
+    for (int i = 0; i < targets.size(); ++i) {
+        QTest::newRow(qPrintable(targets.at(i).name)) << i;
+    }
+}
+
+void ExportBenchmark::benchmarkRender()
+{
+    QFETCH(int, target);
+
+    const ExportTarget &exportTarget = targets.at(target);
+    const ColorSchemeSet schemes(kdeglobals);
+    const Palette palette = computePalette(exportTarget.palette, schemes, RampSettings());
+
+    QByteArray output;
+    QBENCHMARK {
+        output.resize(0);
+        exportTarget.outputTemplate->render(palette, output);
+    }
+    QVERIFY(!output.isEmpty());
+}
+
+void ExportBenchmark::benchmarkWriteUnchanged()
+{
+    const QString path = home.filePath(QStringLiteral("unchanged.css"));
+    const QByteArray content(4096, 'a');
+    QCOMPARE(ExportJob::writeFileIfChanged(path, content), ExportTargetResult::Written);
+
+    QBENCHMARK {
+        QCOMPARE(ExportJob::writeFileIfChanged(path, content), ExportTargetResult::Skipped);
+    }
+}
+
+void ExportBenchmark::benchmarkWriteChanged()
+{
+    const QString path = home.filePath(QStringLiteral("changed.css"));
+    const QByteArray contents[] = {QByteArray(4096, 'a'), QByteArray(4096, 'b')};
+    int next = 0;
+
+    QBENCHMARK {
+        QCOMPARE(ExportJob::writeFileIfChanged(path, contents[next]), ExportTargetResult::Written);
+        next ^= 1;
+    }
+}
+
+void ExportBenchmark::benchmarkSetColors_data()
+{
+    QTest::addColumn<bool>("accentChange");
+
+    // every target checked, none of them written
+    QTest::newRow("unchanged") << false;
+    // the palettes updated, published and the targets using the accent written
+    QTest::newRow("accent change") << true;
+}
+
+void ExportBenchmark::benchmarkSetColors()
+{
+    QFETCH(bool, accentChange);
+
+    QBENCHMARK {
+        if (accentChange) {
+            changeAccent();
+        }
+        QVERIFY(runSetColors());
+    }
+}
+
+// every scheme computed and written
+void ExportBenchmark::benchmarkSchemeBatchCold()
+{
+    schemeSettings.directory = home.filePath(QStringLiteral("schemes-cold"));
+    SchemeBatch batch(home.filePath(QStringLiteral("schemes-cold-stamps")));
+    QBENCHMARK_ONCE {
+        runSchemeBatch(batch);
+    }
+}
+
+// nothing changed since the last batch, only the stamps are checked
+void ExportBenchmark::benchmarkSchemeBatchWarm()
+{
+    schemeSettings.directory = home.filePath(QStringLiteral("schemes-warm"));
+    SchemeBatch batch(home.filePath(QStringLiteral("schemes-warm-stamps")));
+    runSchemeBatch(batch);
+    QBENCHMARK {
+        runSchemeBatch(batch);
+    }
+}
+
+void ExportBenchmark::reportAllocations()
+{
+    if (!AllocationCounter::isSupported()) {
+        QSKIP("Allocation counting needs glibc");
+    }
+
+    const ColorSchemeSet schemes(kdeglobals);
+    const Palette kdePalette = computeKdePalette(schemes);
+    Palette palette;
+    QByteArray output;
+    output.reserve(16384);
+
+    {
+        AllocationCounter counter;
+        const ColorSchemeSet counted(kdeglobals);
+        Q_UNUSED(counted);
+        qInfo() << "ColorSchemeSet:" << counter.count() << "allocations";
+    }
+    {
+        AllocationCounter counter;
+        palette = computeKdePalette(schemes);
+        palette = computeDiscordPalette(schemes);
+        palette = computeRampPalette(schemes, RampSettings());
+        qInfo() << "Palettes:" << counter.count() << "allocations";
+    }
+    {
+        AllocationCounter counter;
+        targets.constFirst().outputTemplate->render(kdePalette, output);
+        qInfo() << "Rendering" << targets.constFirst().name << ":" << counter.count() << "allocations";
+    }
+    // setColors() itself, the job renders and writes on the pool's thread
+    for (bool accentChange : {false, true}) {
+        if (accentChange) {
+            changeAccent();
+        }
+        QSignalSpy finished(module.get(), &kolorExporter::exportFinished);
+        quint64 allocations = 0;
+        {
+            AllocationCounter counter;
+            module->exportNow();
+            allocations = counter.count();
+        }
+        QVERIFY(finished.wait(30000));
+        qInfo() << (accentChange ? "setColors() after an accent change:" : "setColors(), nothing changed:") << allocations << "allocations";
+    }
+}
+
+void ExportBenchmark::cleanupTestCase()
+{
+    module.reset();
+}
+
+QTEST_GUILESS_MAIN(ExportBenchmark)
+
+#include "exportBenchmark.moc"
@@ -0,0 +1,163 @@
+#include "exportCache.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include <KConfigGroup>
+
+class ExportCacheTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void testInputsHash();
+    void testUpToDate();
+    void testVerifyOutputs();
+    void testIncrementalUpdate();
+
+private:
+    KSharedConfigPtr copyFixture(const QString &name);
+    ExportTargetResult writeOutput(const ExportTarget &target, const QByteArray &content);
+
+    QTemporaryDir dir;
+    QList<ExportTarget> targets;
+};
+
+void ExportCacheTest::initTestCase()
+{
+    QVERIFY(dir.isValid());
+
+    auto css = std::make_shared<const OutputTemplate>(OutputTemplate::parse(":root {\n{{#colors}}    --{{name}}: {{hex}};\n{{/colors}}}\n"));
+    targets.append(ExportTarget{QStringLiteral("css"), dir.filePath(QStringLiteral("kde-colors.css")), QString(), KdePalette, css});
+    targets.append(ExportTarget{QStringLiteral("app"), dir.filePath(QStringLiteral("app/kde-colors.css")), dir.filePath(QStringLiteral("app")), KdePalette, css});
+}
+
+KSharedConfigPtr ExportCacheTest::copyFixture(const QString &name)
+{
+    const QString path = dir.filePath(name);
+    QFile::remove(path);
+    if (!QFile::copy(QFINDTESTDATA("data/kdeglobals"), path)) {
+        return {};
+    }
+    QFile::setPermissions(path, QFile::ReadOwner | QFile::WriteOwner);
+    return KSharedConfig::openConfig(path, KConfig::SimpleConfig);
+}
+
+ExportTargetResult ExportCacheTest::writeOutput(const ExportTarget &target, const QByteArray &content)
+{
+    QFile file(target.path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return ExportTargetResult{target.name, target.path, ExportTargetResult::Failed};
+    }
+    file.write(content);
+    return ExportTargetResult{target.name, target.path, ExportTargetResult::Written, QCryptographicHash::hash(content, QCryptographicHash::Sha1)};
+}
+
+void ExportCacheTest::testInputsHash()
+{
+    const KSharedConfigPtr config = copyFixture(QStringLiteral("kdeglobals-hash"));
+    QVERIFY(config);
+
+    const QByteArray original = ExportCache::inputsHash(config, RampSettings(), targets);
+    QCOMPARE(ExportCache::inputsHash(config, RampSettings(), targets), original);
+
+    // unrelated settings don't matter
+    config->group(QStringLiteral("General")).writeEntry("font", QStringLiteral("Noto Sans,10,-1,5,50,0,0,0,0,0"));
+    config->group(QStringLiteral("KDE")).writeEntry("SingleClick", false);
+    QCOMPARE(ExportCache::inputsHash(config, RampSettings(), targets), original);
+
+    // nested color groups do
+    KConfigGroup inactiveHeader = config->group(QStringLiteral("Colors:Header")).group(QStringLiteral("Inactive"));
+    const QString background = inactiveHeader.readEntry("BackgroundNormal", QString());
+    inactiveHeader.writeEntry("BackgroundNormal", QStringLiteral("1,2,3"));
+    QVERIFY(ExportCache::inputsHash(config, RampSettings(), targets) != original);
+    inactiveHeader.writeEntry("BackgroundNormal", background);
+    QCOMPARE(ExportCache::inputsHash(config, RampSettings(), targets), original);
+
+    config->group(QStringLiteral("General")).writeEntry("AccentColor", QStringLiteral("61,174,233"));
+    QVERIFY(ExportCache::inputsHash(config, RampSettings(), targets) != original);
+    config->group(QStringLiteral("General")).deleteEntry("AccentColor");
+    QCOMPARE(ExportCache::inputsHash(config, RampSettings(), targets), original);
+
+    // and so do the targets and their templates
+    QList<ExportTarget> moved = targets;
+    moved.first().path = dir.filePath(QStringLiteral("moved.css"));
+    QVERIFY(ExportCache::inputsHash(config, RampSettings(), moved) != original);
+
+    QList<ExportTarget> otherTemplate = targets;
+    otherTemplate.first().outputTemplate = std::make_shared<const OutputTemplate>(OutputTemplate::parse("{{#colors}}{{name}}={{hex}}\n{{/colors}}"));
+    QVERIFY(ExportCache::inputsHash(config, RampSettings(), otherTemplate) != original);
+
+    // and which shades the ramps have
+    RampSettings ramps;
+    ramps.stopCount = 5;
+    QVERIFY(ExportCache::inputsHash(config, ramps, targets) != original);
+    ramps = RampSettings();
+    ramps.space = ShadeRamp::Hsl;
+    QVERIFY(ExportCache::inputsHash(config, ramps, targets) != original);
+}
+
+void ExportCacheTest::testUpToDate()
+{
+    const QString cachePath = dir.filePath(QStringLiteral("cache/exportcache-uptodate"));
+    const QByteArray inputs = QCryptographicHash::hash("inputs", QCryptographicHash::Sha1);
+    {
+        ExportCache cache(cachePath);
+        QVERIFY(!cache.isUpToDate(inputs));
+        cache.store(inputs, {writeOutput(targets.first(), "first\n")});
+        QVERIFY(cache.isUpToDate(inputs));
+    }
+    QVERIFY(QFile::exists(cachePath));
+
+    ExportCache cache(cachePath);
+    QVERIFY(cache.isUpToDate(inputs));
+    QVERIFY(!cache.isUpToDate(QCryptographicHash::hash("other inputs", QCryptographicHash::Sha1)));
+
+    QVERIFY(QFile::remove(targets.first().path));
+    QVERIFY(!cache.isUpToDate(inputs));
+}
+
+void ExportCacheTest::testVerifyOutputs()
+{
+    ExportCache cache(dir.filePath(QStringLiteral("cache/exportcache-verify")));
+    const QByteArray inputs = QCryptographicHash::hash("inputs", QCryptographicHash::Sha1);
+    QDir(dir.filePath(QStringLiteral("app"))).removeRecursively();
+
+    cache.store(inputs, {writeOutput(targets.first(), "first\n")});
+    QVERIFY(cache.verifyOutputs(targets));
+
+    // edited behind our back
+    writeOutput(targets.first(), "edited\n");
+    QVERIFY(!cache.verifyOutputs(targets));
+
+    // the app of the second target got installed since the last export
+    cache.store(inputs, {writeOutput(targets.first(), "first\n")});
+    QVERIFY(QDir().mkpath(targets.last().requiredDirectory));
+    QVERIFY(!cache.verifyOutputs(targets));
+
+    cache.store(inputs, {writeOutput(targets.first(), "first\n"), writeOutput(targets.last(), "second\n")});
+    QVERIFY(cache.verifyOutputs(targets));
+}
+
+void ExportCacheTest::testIncrementalUpdate()
+{
+    ExportCache cache(dir.filePath(QStringLiteral("cache/exportcache-incremental")));
+    const QByteArray inputs = QCryptographicHash::hash("inputs", QCryptographicHash::Sha1);
+    const QByteArray accentChanged = QCryptographicHash::hash("accent changed", QCryptographicHash::Sha1);
+    QVERIFY(QDir().mkpath(targets.last().requiredDirectory));
+
+    cache.store(inputs, {writeOutput(targets.first(), "first\n"), writeOutput(targets.last(), "second\n")});
+
+    // only the first target uses the accent
+    cache.update(accentChanged, {writeOutput(targets.first(), "first with accent\n")});
+    QVERIFY(cache.isUpToDate(accentChanged));
+    QVERIFY(!cache.isUpToDate(inputs));
+    QVERIFY(cache.verifyOutputs(targets));
+}
+
+QTEST_GUILESS_MAIN(ExportCacheTest)
+
+#include "exportCacheTest.moc"
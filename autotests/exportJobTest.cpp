@@ -0,0 +1,267 @@
+#include "exportJob.h"
+#include "goldenFile.h"
+#include "targetRegistry.h"
+
+#include <QDir>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include <KConfig>
+#include <KConfigGroup>
+
+class ExportJobTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+    void testFirstExportWrites();
+    void testUnchangedExportSkips();
+    void testSupersededExportIsCancelled();
+    void testConfiguredTargets();
+    void testSharedContent();
+    void testPartialExportLinks();
+
+private:
+    // the targets of the config that are installed in the sandbox
+    static QList<ExportTarget> installedTargets(const QString &configPath);
+    // allTargets is targets if empty
+    ExportResult runExport(const QList<ExportTarget> &targets, quint64 latestGeneration = 1, const QList<ExportTarget> &allTargets = {});
+    static ExportTargetResult::Status statusOf(const ExportResult &result, const QString &name);
+    static QByteArray readFile(const QString &path);
+
+    QTemporaryDir home;
+    KSharedConfigPtr kdeglobals;
+    QString configDir;
+    QString dataDir;
+};
+
+void ExportJobTest::initTestCase()
+{
+    // the flatpak targets live in $HOME, keep them away from the real one
+    QVERIFY(home.isValid());
+    qputenv("HOME", QFile::encodeName(home.path()));
+    QStandardPaths::setTestModeEnabled(true);
+
+    configDir = QStandardPaths::writableLocation(QStandardPaths::GenericConfigLocation);
+    dataDir = QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation);
+    kdeglobals = KSharedConfig::openConfig(QFINDTESTDATA("data/kdeglobals"), KConfig::SimpleConfig);
+}
+
+void ExportJobTest::init()
+{
+    QDir(configDir).removeRecursively();
+    QDir(dataDir).removeRecursively();
+
+    QVERIFY(QDir().mkpath(dataDir + QStringLiteral("/rofi/themes")));
+    // only vencord is "installed", vesktop and the flatpaks are not
+    QVERIFY(QDir().mkpath(configDir + QStringLiteral("/Vencord")));
+}
+
+QList<ExportTarget> ExportJobTest::installedTargets(const QString &configPath)
+{
+    TargetRegistry registry;
+    registry.setTargets(loadExportTargets(KSharedConfig::openConfig(configPath, KConfig::SimpleConfig)));
+    return registry.availableTargets();
+}
+
+ExportResult ExportJobTest::runExport(const QList<ExportTarget> &targets, quint64 latestGeneration, const QList<ExportTarget> &allTargets)
+{
+    ExportSnapshot snapshot;
+    snapshot.generation = 1;
+    const ColorSchemeSet schemes(kdeglobals);
+    for (int id = 0; id < PaletteCount; id++) {
+        snapshot.palettes[id] = computePalette(PaletteId(id), schemes, RampSettings());
+    }
+    snapshot.targets = targets;
+    snapshot.allTargets = allTargets.isEmpty() ? targets : allTargets;
+
+    ExportResult result;
+    ExportJob job(std::move(snapshot), std::make_shared<std::atomic<quint64>>(latestGeneration), [&result](const ExportResult &finished) {
+        result = finished;
+    });
+    job.run();
+    return result;
+}
+
+ExportTargetResult::Status ExportJobTest::statusOf(const ExportResult &result, const QString &name)
+{
+    for (const ExportTargetResult &target : result.targets) {
+        if (target.name == name) {
+            return target.status;
+        }
+    }
+    return ExportTargetResult::Failed;
+}
+
+QByteArray ExportJobTest::readFile(const QString &path)
+{
+    QFile file(path);
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+
+void ExportJobTest::testFirstExportWrites()
+{
+    const QList<ExportTarget> targets = installedTargets(home.filePath(QStringLiteral("kolorexporterrc")));
+    QCOMPARE(targets.size(), qsizetype(3));
+
+    const ExportResult result = runExport(targets);
+    QVERIFY(!result.cancelled);
+    QCOMPARE(result.targets.size(), qsizetype(3));
+    QCOMPARE(statusOf(result, QStringLiteral("kde-colors")), ExportTargetResult::Written);
+    QCOMPARE(statusOf(result, QStringLiteral("rofi")), ExportTargetResult::Written);
+    QCOMPARE(statusOf(result, QStringLiteral("vencord")), ExportTargetResult::Written);
+
+    QVERIFY(compareWithGolden(readFile(configDir + QStringLiteral("/kde-colors.css")), QStringLiteral("kde-colors.css")));
+    QVERIFY(compareWithGolden(readFile(dataDir + QStringLiteral("/rofi/themes/kde-colors.rasi")), QStringLiteral("kde-colors.rasi")));
+
+    // the whole discord palette, brand-* and primary-* ramps included
+    const QByteArray vencord = readFile(configDir + QStringLiteral("/Vencord/themes/kde-colors.css"));
+    QVERIFY2(compareWithGolden(vencord, QStringLiteral("vencord-kde-colors.css")), vencord.constData());
+    QVERIFY(!QFileInfo::exists(configDir + QStringLiteral("/vesktop")));
+}
+
+void ExportJobTest::testUnchangedExportSkips()
+{
+    const QList<ExportTarget> targets = installedTargets(home.filePath(QStringLiteral("kolorexporterrc")));
+    runExport(targets);
+
+    ExportResult result = runExport(targets);
+    QCOMPARE(result.targets.size(), qsizetype(3));
+    for (const ExportTargetResult &target : std::as_const(result.targets)) {
+        QCOMPARE(target.status, ExportTargetResult::Skipped);
+    }
+
+    // a file changed behind our back gets rewritten
+    QFile css(configDir + QStringLiteral("/kde-colors.css"));
+    QVERIFY(css.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    css.write(":root {}\n");
+    css.close();
+
+    result = runExport(targets);
+    QCOMPARE(statusOf(result, QStringLiteral("kde-colors")), ExportTargetResult::Written);
+    QCOMPARE(statusOf(result, QStringLiteral("rofi")), ExportTargetResult::Skipped);
+    QVERIFY(compareWithGolden(readFile(css.fileName()), QStringLiteral("kde-colors.css")));
+}
+
+void ExportJobTest::testSupersededExportIsCancelled()
+{
+    const QList<ExportTarget> targets = installedTargets(home.filePath(QStringLiteral("kolorexporterrc")));
+
+    const ExportResult result = runExport(targets, 2);
+    QVERIFY(result.cancelled);
+    QVERIFY(result.targets.isEmpty());
+    QVERIFY(!QFileInfo::exists(configDir + QStringLiteral("/kde-colors.css")));
+}
+
+void ExportJobTest::testConfiguredTargets()
+{
+    const QString configPath = home.filePath(QStringLiteral("configured-kolorexporterrc"));
+    {
+        KConfig config(configPath, KConfig::SimpleConfig);
+        KConfigGroup targets = config.group(QStringLiteral("Targets"));
+
+        KConfigGroup json = targets.group(QStringLiteral("json"));
+        json.writeEntry("Path", configDir + QStringLiteral("/kde-colors.json"));
+        json.writeEntry("Template", QStringLiteral("json"));
+
+        targets.group(QStringLiteral("rofi")).writeEntry("Enabled", false);
+        QVERIFY(config.sync());
+    }
+
+    const QList<ExportTarget> configured = loadExportTargets(KSharedConfig::openConfig(configPath, KConfig::SimpleConfig));
+    QCOMPARE(configured.size(), qsizetype(6));
+    QCOMPARE(configured.constLast().name, QStringLiteral("json"));
+    QCOMPARE(configured.constLast().palette, KdePalette);
+
+    const QList<ExportTarget> targets = installedTargets(configPath);
+    QCOMPARE(targets.size(), qsizetype(3));
+
+    const ExportResult result = runExport(targets);
+    QCOMPARE(statusOf(result, QStringLiteral("json")), ExportTargetResult::Written);
+    QVERIFY(!QFileInfo::exists(dataDir + QStringLiteral("/rofi/themes/kde-colors.rasi")));
+    QVERIFY(readFile(configDir + QStringLiteral("/kde-colors.json")).startsWith("{\n    \"borders-breeze\": \"#bcbdbf\",\n"));
+}
+
+void ExportJobTest::testSharedContent()
+{
+    const QString dir = configDir + QStringLiteral("/shared");
+    QVERIFY(QDir().mkpath(dir));
+
+    auto css = std::make_shared<const OutputTemplate>(OutputTemplate::parse(":root {\n{{#colors}}    --{{name}}: {{hex}};\n{{/colors}}}\n"));
+    auto json = std::make_shared<const OutputTemplate>(OutputTemplate::parse("{\n{{#colors}}    \"{{name}}\": \"{{hex}}\"{{comma}}\n{{/colors}}}\n"));
+    const QList<ExportTarget> targets = {
+        // the link comes first, it still points at the first target of its group that isn't one
+        ExportTarget{QStringLiteral("link"), dir + QStringLiteral("/link.css"), QString(), KdePalette, css, true},
+        ExportTarget{QStringLiteral("first"), dir + QStringLiteral("/first.css"), QString(), KdePalette, css},
+        ExportTarget{QStringLiteral("json"), dir + QStringLiteral("/colors.json"), QString(), KdePalette, json},
+        ExportTarget{QStringLiteral("second"), dir + QStringLiteral("/second.css"), QString(), KdePalette, css},
+        ExportTarget{QStringLiteral("discord"), dir + QStringLiteral("/discord.css"), QString(), DiscordPalette, css},
+    };
+
+    ExportResult result = runExport(targets);
+    QCOMPARE(result.targets.size(), qsizetype(5));
+    for (const ExportTargetResult &target : std::as_const(result.targets)) {
+        QCOMPARE(target.status, ExportTargetResult::Written);
+    }
+    // but it's made after the file it points to
+    QCOMPARE(result.targets.at(0).name, QStringLiteral("first"));
+    QCOMPARE(result.targets.at(1).name, QStringLiteral("second"));
+    QCOMPARE(result.targets.at(2).name, QStringLiteral("link"));
+    // only real files count
+    const qsizetype written = 2 * readFile(dir + QStringLiteral("/first.css")).size() + readFile(dir + QStringLiteral("/colors.json")).size()
+        + readFile(dir + QStringLiteral("/discord.css")).size();
+    QCOMPARE(result.bytesWritten, qint64(written));
+
+    QVERIFY(compareWithGolden(readFile(dir + QStringLiteral("/first.css")), QStringLiteral("kde-colors.css")));
+    QCOMPARE(readFile(dir + QStringLiteral("/second.css")), readFile(dir + QStringLiteral("/first.css")));
+    QVERIFY(readFile(dir + QStringLiteral("/discord.css")) != readFile(dir + QStringLiteral("/first.css")));
+
+    const QFileInfo link(dir + QStringLiteral("/link.css"));
+    QVERIFY(link.isSymLink());
+    QCOMPARE(link.symLinkTarget(), QFileInfo(dir + QStringLiteral("/first.css")).absoluteFilePath());
+
+    result = runExport(targets);
+    for (const ExportTargetResult &target : std::as_const(result.targets)) {
+        QCOMPARE(target.status, ExportTargetResult::Skipped);
+    }
+
+    // a copy left from before Link=true was set gets replaced
+    QVERIFY(QFile::remove(link.filePath()));
+    QVERIFY(QFile::copy(dir + QStringLiteral("/first.css"), link.filePath()));
+    result = runExport(targets);
+    QCOMPARE(statusOf(result, QStringLiteral("link")), ExportTargetResult::Written);
+    QVERIFY(QFileInfo(link.filePath()).isSymLink());
+}
+
+void ExportJobTest::testPartialExportLinks()
+{
+    const QString dir = configDir + QStringLiteral("/partial");
+    QVERIFY(QDir().mkpath(dir));
+
+    auto css = std::make_shared<const OutputTemplate>(OutputTemplate::parse(":root {\n{{#colors}}    --{{name}}: {{hex}};\n{{/colors}}}\n"));
+    const ExportTarget canonical{QStringLiteral("canonical"), dir + QStringLiteral("/canonical.css"), QString(), KdePalette, css};
+    const ExportTarget link{QStringLiteral("link"), dir + QStringLiteral("/link.css"), QString(), KdePalette, css, true};
+
+    // like an app that was just installed: only the link is exported, its canonical
+    // file isn't there yet so it gets a copy
+    ExportResult result = runExport({link}, 1, {canonical, link});
+    QCOMPARE(statusOf(result, QStringLiteral("link")), ExportTargetResult::Written);
+    QVERIFY(!QFileInfo(link.path).isSymLink());
+    QVERIFY(compareWithGolden(readFile(link.path), QStringLiteral("kde-colors.css")));
+
+    // once it is, the link points at it even if the export doesn't include it
+    runExport({canonical});
+    result = runExport({link}, 1, {canonical, link});
+    QCOMPARE(result.targets.size(), qsizetype(1));
+    QCOMPARE(statusOf(result, QStringLiteral("link")), ExportTargetResult::Written);
+    QVERIFY(QFileInfo(link.path).isSymLink());
+    QCOMPARE(QFileInfo(link.path).symLinkTarget(), QFileInfo(canonical.path).absoluteFilePath());
+    QVERIFY(QFileInfo::exists(canonical.path));
+}
+
+QTEST_GUILESS_MAIN(ExportJobTest)
+
+#include "exportJobTest.moc"
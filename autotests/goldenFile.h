@@ -0,0 +1,30 @@
+#pragma once
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+// What the module wrote for data/kdeglobals before the exports went through templates,
+// the default targets have to match it byte for byte. Never rewritten from the current output
+inline bool isBaselineGolden(const QString &name)
+{
+    return name == QStringLiteral("kde-colors.css") || name == QStringLiteral("kde-colors.rasi") || name == QStringLiteral("vencord-kde-colors.css");
+}
+
+// Compares output with autotests/data/golden/<name>. Running the tests with
+// KOLOR_EXPORTER_UPDATE_GOLDEN=1 rewrites the golden files from the current output instead,
+// except for the baseline ones.
+inline bool compareWithGolden(const QByteArray &output, const QString &name)
+{
+    QFile golden(QStringLiteral(KOLOR_EXPORTER_TEST_DATA "/golden/") + name);
+
+    if (qEnvironmentVariableIntValue("KOLOR_EXPORTER_UPDATE_GOLDEN") && !isBaselineGolden(name)) {
+        return golden.open(QIODevice::WriteOnly | QIODevice::Truncate) && golden.write(output) == output.size();
+    }
+
+    if (!golden.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    return golden.readAll() == output;
+}
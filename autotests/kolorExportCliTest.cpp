@@ -0,0 +1,186 @@
+#include "goldenFile.h"
+
+#include <QFile>
+#include <QProcess>
+#include <QTemporaryDir>
+#include <QTest>
+
+class KolorExportCliTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void testStdout();
+    void testBadArguments_data();
+    void testBadArguments();
+    void testExport();
+    void testDefaultTargets();
+    void testWatchConfig();
+
+private:
+    // never touch the real home
+    QProcessEnvironment environment() const;
+    // exit code of kolor-export, its stdout in output
+    int run(const QStringList &arguments, QByteArray *output = nullptr);
+
+    QTemporaryDir home;
+};
+
+void KolorExportCliTest::initTestCase()
+{
+    QVERIFY(home.isValid());
+}
+
+QProcessEnvironment KolorExportCliTest::environment() const
+{
+    QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+    environment.insert(QStringLiteral("HOME"), home.path());
+    environment.insert(QStringLiteral("XDG_CONFIG_HOME"), home.filePath(QStringLiteral(".config")));
+    environment.insert(QStringLiteral("XDG_DATA_HOME"), home.filePath(QStringLiteral(".local/share")));
+    environment.remove(QStringLiteral("QT_QPA_PLATFORM"));
+    return environment;
+}
+
+int KolorExportCliTest::run(const QStringList &arguments, QByteArray *output)
+{
+    QProcess process;
+    process.setProcessEnvironment(environment());
+    process.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+    process.start(QStringLiteral(KOLOR_EXPORT_BINARY), arguments);
+    if (!process.waitForFinished(30000) || process.exitStatus() != QProcess::NormalExit) {
+        return -1;
+    }
+    if (output) {
+        *output = process.readAllStandardOutput();
+    }
+    return process.exitCode();
+}
+
+void KolorExportCliTest::testStdout()
+{
+    QByteArray output;
+    QCOMPARE(run({QStringLiteral("--scheme"), QFINDTESTDATA("data/kdeglobals"), QStringLiteral("--stdout")}, &output), 0);
+    QVERIFY(compareWithGolden(output, QStringLiteral("kde-colors.css")));
+
+    QCOMPARE(run({QStringLiteral("--scheme"), QFINDTESTDATA("data/kdeglobals"), QStringLiteral("--stdout"), QStringLiteral("--template"), QStringLiteral("rasi")},
+                 &output),
+             0);
+    QVERIFY(compareWithGolden(output, QStringLiteral("kde-colors.rasi")));
+
+    // the ramps come from [Ramps] of --config, in any order
+    const QString config = home.filePath(QStringLiteral("rampsrc"));
+    {
+        QFile file(config);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write("[Ramps]\nRoles=link,negative\nStops=500,100\nSpace=hsl\n");
+    }
+    QCOMPARE(run({QStringLiteral("--scheme"),
+                  QFINDTESTDATA("data/kdeglobals"),
+                  QStringLiteral("--config"),
+                  config,
+                  QStringLiteral("--stdout"),
+                  QStringLiteral("--template"),
+                  QStringLiteral("json"),
+                  QStringLiteral("--palette"),
+                  QStringLiteral("ramps")},
+                 &output),
+             0);
+    QCOMPARE(output.count("\": \"#"), qsizetype(4));
+    QVERIFY(output.contains("\"link-100\""));
+    QVERIFY(output.contains("\"negative-500\""));
+    QVERIFY(!output.contains("\"accent-500\""));
+}
+
+void KolorExportCliTest::testBadArguments_data()
+{
+    QTest::addColumn<QStringList>("arguments");
+
+    QTest::newRow("missing scheme") << QStringList{QStringLiteral("--scheme"), QStringLiteral("/nonexistent.colors")};
+    QTest::newRow("unknown palette") << QStringList{QStringLiteral("--stdout"), QStringLiteral("--palette"), QStringLiteral("nope")};
+    QTest::newRow("unknown template") << QStringList{QStringLiteral("--stdout"), QStringLiteral("--template"), QStringLiteral("nope")};
+    QTest::newRow("unknown target") << QStringList{QStringLiteral("--target"), QStringLiteral("nope")};
+}
+
+void KolorExportCliTest::testBadArguments()
+{
+    QFETCH(QStringList, arguments);
+    QCOMPARE(run(arguments), 1);
+}
+
+void KolorExportCliTest::testExport()
+{
+    const QString output = home.filePath(QStringLiteral("colors.css"));
+    const QString config = home.filePath(QStringLiteral("exportrc"));
+    {
+        QFile file(config);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write("[Targets][test]\nTemplate=css\nPath=" + QFile::encodeName(output) + "\n");
+    }
+
+    const QStringList arguments = {
+        QStringLiteral("--scheme"),
+        QFINDTESTDATA("data/kdeglobals"),
+        QStringLiteral("--config"),
+        config,
+        QStringLiteral("--target"),
+        QStringLiteral("test"),
+    };
+    QCOMPARE(run(arguments), 0);
+
+    QFile file(output);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QVERIFY(compareWithGolden(file.readAll(), QStringLiteral("kde-colors.css")));
+    // only the target that was asked for
+    QVERIFY(!QFile::exists(home.filePath(QStringLiteral(".config/kde-colors.css"))));
+}
+
+void KolorExportCliTest::testDefaultTargets()
+{
+    // none of the apps are installed, only kde-colors is written and that's a success
+    QCOMPARE(run({QStringLiteral("--scheme"), QFINDTESTDATA("data/kdeglobals")}), 0);
+
+    QFile file(home.filePath(QStringLiteral(".config/kde-colors.css")));
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QVERIFY(compareWithGolden(file.readAll(), QStringLiteral("kde-colors.css")));
+    QVERIFY(!QFile::exists(home.filePath(QStringLiteral(".local/share/rofi/themes/kde-colors.rasi"))));
+
+    // asking for one that isn't installed isn't a failure either
+    QCOMPARE(run({QStringLiteral("--scheme"), QFINDTESTDATA("data/kdeglobals"), QStringLiteral("--target"), QStringLiteral("rofi")}), 0);
+}
+
+void KolorExportCliTest::testWatchConfig()
+{
+    const QString config = home.filePath(QStringLiteral("watchrc"));
+    const QString first = home.filePath(QStringLiteral("watch/first.css"));
+    const QString second = home.filePath(QStringLiteral("watch/second.json"));
+    auto writeConfig = [&config](const QByteArray &content) {
+        QFile file(config);
+        QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+        file.write(content);
+    };
+    writeConfig("[Targets][first]\nTemplate=css\nPath=" + QFile::encodeName(first) + "\n");
+
+    QProcess process;
+    process.setProcessEnvironment(environment());
+    process.setProcessChannelMode(QProcess::ForwardedChannels);
+    process.start(QStringLiteral(KOLOR_EXPORT_BINARY),
+                  {QStringLiteral("--scheme"), QFINDTESTDATA("data/kdeglobals"), QStringLiteral("--config"), config, QStringLiteral("--watch")});
+    QVERIFY(process.waitForStarted());
+    QTRY_VERIFY_WITH_TIMEOUT(QFile::exists(first), 30000);
+
+    // a target added to the config while it runs is exported without a restart
+    writeConfig("[Targets][first]\nTemplate=css\nPath=" + QFile::encodeName(first) + "\n[Targets][second]\nTemplate=json\nPath=" + QFile::encodeName(second)
+                + "\n");
+    QTRY_VERIFY_WITH_TIMEOUT(QFile::exists(second), 30000);
+    QFile json(second);
+    QVERIFY(json.open(QIODevice::ReadOnly));
+    QVERIFY(json.readAll().startsWith("{\n    \"borders-breeze\": \"#bcbdbf\",\n"));
+
+    process.kill();
+    QVERIFY(process.waitForFinished());
+}
+
+QTEST_GUILESS_MAIN(KolorExportCliTest)
+
+#include "kolorExportCliTest.moc"
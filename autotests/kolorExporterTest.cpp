@@ -0,0 +1,85 @@
+#include "exportCache.h"
+#include "kolorExporter.h"
+
+#include <QDir>
+#include <QSignalSpy>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QTest>
+
+// The module in a sandbox where none of the apps are installed, only kde-colors
+// has somewhere to go.
+class KolorExporterTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void testUninstalledAppsAreCached();
+    void testAppInstalled();
+
+private:
+    QTemporaryDir home;
+};
+
+void KolorExporterTest::initTestCase()
+{
+    QVERIFY(home.isValid());
+    qputenv("HOME", QFile::encodeName(home.path()));
+    // the module would replace the session's socket otherwise
+    const QString runtimeDir = home.filePath(QStringLiteral("runtime"));
+    QVERIFY(QDir().mkpath(runtimeDir));
+    QVERIFY(QFile::setPermissions(runtimeDir, QFile::ReadOwner | QFile::WriteOwner | QFile::ExeOwner));
+    qputenv("XDG_RUNTIME_DIR", QFile::encodeName(runtimeDir));
+    QStandardPaths::setTestModeEnabled(true);
+
+    const QString configDir = QStandardPaths::writableLocation(QStandardPaths::GenericConfigLocation);
+    QDir(configDir).removeRecursively();
+    QDir(QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation)).removeRecursively();
+    QDir(QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)).removeRecursively();
+    QVERIFY(QDir().mkpath(configDir));
+    QVERIFY(QFile::copy(QFINDTESTDATA("data/kdeglobals"), configDir + QStringLiteral("/kdeglobals")));
+}
+
+void KolorExporterTest::testUninstalledAppsAreCached()
+{
+    {
+        kolorExporter module(nullptr, QVariantList());
+        QSignalSpy finished(&module, &kolorExporter::exportFinished);
+        QVERIFY(finished.wait(30000));
+
+        const QVariantMap targets = module.metrics().value(QStringLiteral("targets")).toMap();
+        QCOMPARE(targets.keys(), QStringList{QStringLiteral("kde-colors")});
+        QCOMPARE(targets.value(QStringLiteral("kde-colors")).toMap().value(QStringLiteral("written")).toULongLong(), quint64(1));
+    }
+
+    // rofi and vencord not being installed isn't a failure, the export is remembered
+    const QByteArray inputs =
+        ExportCache::inputsHash(KSharedConfig::openConfig(), RampSettings(), loadExportTargets(KSharedConfig::openConfig(QStringLiteral("kolorexporterrc"))));
+    QVERIFY(ExportCache().isUpToDate(inputs));
+
+    // so the next start has nothing to do
+    kolorExporter module(nullptr, QVariantList());
+    QSignalSpy finished(&module, &kolorExporter::exportFinished);
+    QVERIFY(!finished.wait(1000));
+    QCOMPARE(module.metrics().value(QStringLiteral("exports")).toULongLong(), quint64(0));
+}
+
+void KolorExporterTest::testAppInstalled()
+{
+    kolorExporter module(nullptr, QVariantList());
+
+    // like installing Vencord, it makes themes/ only later
+    const QString vencord = QStandardPaths::writableLocation(QStandardPaths::GenericConfigLocation) + QStringLiteral("/Vencord");
+    QVERIFY(QDir().mkpath(vencord));
+    QTRY_VERIFY_WITH_TIMEOUT(QFile::exists(vencord + QStringLiteral("/themes/kde-colors.css")), 10000);
+
+    QTRY_COMPARE(module.metrics().value(QStringLiteral("exports")).toULongLong(), quint64(1));
+    const QVariantMap stats = module.metrics().value(QStringLiteral("targets")).toMap().value(QStringLiteral("vencord")).toMap();
+    QCOMPARE(stats.value(QStringLiteral("written")).toULongLong(), quint64(1));
+    QCOMPARE(stats.value(QStringLiteral("failed")).toULongLong(), quint64(0));
+}
+
+QTEST_GUILESS_MAIN(KolorExporterTest)
+
+#include "kolorExporterTest.moc"
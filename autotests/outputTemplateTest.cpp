@@ -0,0 +1,171 @@
+#include "goldenFile.h"
+#include "outputTemplate.h"
+
+#include <QTest>
+
+using namespace Qt::Literals::StringLiterals;
+
+class OutputTemplateTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testBuiltinTemplates_data();
+    void testBuiltinTemplates();
+    void testTerminalColors();
+    void testParseErrors_data();
+    void testParseErrors();
+    void testNamedColors();
+    void testEscape();
+    void testUsesColor();
+    void testEmptyPalette();
+};
+
+static Palette testPalette()
+{
+    Palette palette;
+    palette.append("theme-text-color-breeze"_L1, QColor(0x23, 0x26, 0x29));
+    palette.append("theme-base-color-breeze"_L1, QColor(0xff, 0xff, 0xff));
+    palette.append("theme-selected-fg-color-breeze"_L1, QColor(0xfc, 0xfc, 0xfc));
+    palette.append("theme-selected-bg-color-breeze"_L1, QColor(0x3d, 0xae, 0xe9));
+    palette.append("insensitive-fg-color-breeze"_L1, QColor(0xa0, 0xa2, 0xa4));
+    palette.append("link-color-breeze"_L1, QColor(0x29, 0x80, 0xb9));
+    palette.append("link-visited-color-breeze"_L1, QColor(0x9b, 0x59, 0xb6));
+    palette.append("borders-breeze"_L1, QColor(0xbc, 0xbd, 0xbf));
+    palette.append("theme-fg-color-breeze"_L1, QColor(0x23, 0x26, 0x27));
+    palette.append("theme-bg-color-breeze"_L1, QColor(0xef, 0xf0, 0xf1));
+    palette.append("theme-header-background-breeze"_L1, QColor(0xde, 0xe0, 0xe2));
+    palette.append("error-color-breeze"_L1, QColor(0xda, 0x44, 0x53));
+    palette.append("success-color-breeze"_L1, QColor(0x27, 0xae, 0x60));
+    palette.append("warning-color-breeze"_L1, QColor(0xf6, 0x74, 0x00));
+    palette.sort();
+    return palette;
+}
+
+void OutputTemplateTest::testBuiltinTemplates_data()
+{
+    QTest::addColumn<QString>("name");
+
+    for (const char *name : {"alacritty", "css", "gtk", "json", "kitty", "rasi", "vencord", "xresources"}) {
+        QTest::newRow(name) << QString::fromLatin1(name);
+    }
+}
+
+void OutputTemplateTest::testBuiltinTemplates()
+{
+    QFETCH(QString, name);
+
+    QFile file(QStringLiteral(":/kolor-exporter/templates/%1.tmpl").arg(name));
+    QVERIFY(file.open(QIODevice::ReadOnly));
+
+    const OutputTemplate outputTemplate = OutputTemplate::parse(file.readAll());
+    QVERIFY2(outputTemplate.isValid(), qPrintable(outputTemplate.errorString()));
+
+    QByteArray output;
+    outputTemplate.render(testPalette(), output);
+
+    QVERIFY2(compareWithGolden(output, name + QStringLiteral(".txt")), output.constData());
+}
+
+static QByteArray renderBuiltin(const QString &name)
+{
+    QFile file(QStringLiteral(":/kolor-exporter/templates/%1.tmpl").arg(name));
+    QByteArray output;
+    if (file.open(QIODevice::ReadOnly)) {
+        OutputTemplate::parse(file.readAll()).render(testPalette(), output);
+    }
+    return output;
+}
+
+// all 16 ansi colors are set, the terminal's own defaults can be unreadable on the scheme
+void OutputTemplateTest::testTerminalColors()
+{
+    const QByteArray kitty = renderBuiltin(QStringLiteral("kitty"));
+    const QByteArray xresources = renderBuiltin(QStringLiteral("xresources"));
+    for (int i = 0; i < 16; i++) {
+        QVERIFY2(kitty.contains("\ncolor" + QByteArray::number(i) + " #"), qPrintable(QString::number(i)));
+        QVERIFY2(xresources.contains("\n*.color" + QByteArray::number(i) + ": #"), qPrintable(QString::number(i)));
+    }
+
+    const QByteArray alacritty = renderBuiltin(QStringLiteral("alacritty"));
+    const qsizetype normal = alacritty.indexOf("[colors.normal]\n");
+    const qsizetype bright = alacritty.indexOf("[colors.bright]\n");
+    QVERIFY(normal >= 0 && bright > normal);
+    for (const QByteArray &section : {alacritty.sliced(normal, bright - normal), alacritty.sliced(bright)}) {
+        for (const char *color : {"black", "red", "green", "yellow", "blue", "magenta", "cyan", "white"}) {
+            QVERIFY2(section.contains('\n' + QByteArray(color) + " = \"#"), color);
+        }
+    }
+}
+
+void OutputTemplateTest::testParseErrors_data()
+{
+    QTest::addColumn<QByteArray>("source");
+
+    QTest::newRow("unterminated tag") << QByteArray("{{#colors}}{{name");
+    QTest::newRow("loop never closed") << QByteArray("{{#colors}}{{name}}");
+    QTest::newRow("loop never opened") << QByteArray("{{/colors}}");
+    QTest::newRow("nested loop") << QByteArray("{{#colors}}{{#colors}}{{/colors}}{{/colors}}");
+    QTest::newRow("color tag outside loop") << QByteArray("{{hex}}");
+    QTest::newRow("unknown tag") << QByteArray("{{#colors}}{{bogus}}{{/colors}}");
+}
+
+void OutputTemplateTest::testParseErrors()
+{
+    QFETCH(QByteArray, source);
+
+    const OutputTemplate outputTemplate = OutputTemplate::parse(source);
+    QVERIFY(!outputTemplate.isValid());
+    QVERIFY(!outputTemplate.errorString().isEmpty());
+}
+
+void OutputTemplateTest::testNamedColors()
+{
+    const OutputTemplate outputTemplate = OutputTemplate::parse("{{hex link-color-breeze}} {{ rgb link-color-breeze }} [{{hex missing}}]\n");
+    QVERIFY2(outputTemplate.isValid(), qPrintable(outputTemplate.errorString()));
+
+    QByteArray output;
+    outputTemplate.render(testPalette(), output);
+    QCOMPARE(output, QByteArray("#2980b9 41, 128, 185 []\n"));
+    QCOMPARE(outputTemplate.namedColors(), QByteArrayList({"link-color-breeze", "missing"}));
+}
+
+void OutputTemplateTest::testEscape()
+{
+    const OutputTemplate outputTemplate = OutputTemplate::parse("\\{{hex}} {{#colors}}\\{{ {{name}}{{/colors}} \\}} {\\{\n");
+    QVERIFY2(outputTemplate.isValid(), qPrintable(outputTemplate.errorString()));
+
+    Palette palette;
+    palette.append("a"_L1, QColor(0, 0, 0));
+    QByteArray output;
+    outputTemplate.render(palette, output);
+    QCOMPARE(output, QByteArray("{{hex}} {{ a \\}} {\\{\n"));
+}
+
+void OutputTemplateTest::testUsesColor()
+{
+    const OutputTemplate named = OutputTemplate::parse("a {{hex link-color-breeze}} b {{rgb error-color-breeze}}\n");
+    QVERIFY(named.usesColor("link-color-breeze"_L1));
+    QVERIFY(named.usesColor("error-color-breeze"_L1));
+    QVERIFY(!named.usesColor("link-color"_L1));
+    QVERIFY(!named.usesColor("success-color-breeze"_L1));
+
+    // a loop writes every color
+    const OutputTemplate loop = OutputTemplate::parse("{{#colors}}{{name}}{{/colors}}");
+    QVERIFY(loop.usesColor("success-color-breeze"_L1));
+    QVERIFY(!OutputTemplate::parse("no colors\n").usesColor("success-color-breeze"_L1));
+}
+
+void OutputTemplateTest::testEmptyPalette()
+{
+    const OutputTemplate outputTemplate = OutputTemplate::parse("{\n{{#colors}}    \"{{name}}\": \"{{hex}}\"{{comma}}\n{{/colors}}}\n");
+    QVERIFY(outputTemplate.isValid());
+
+    QByteArray output;
+    outputTemplate.render(Palette(), output);
+    QCOMPARE(output, QByteArray("{\n}\n"));
+}
+
+QTEST_GUILESS_MAIN(OutputTemplateTest)
+
+#include "outputTemplateTest.moc"
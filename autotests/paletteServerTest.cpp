@@ -0,0 +1,211 @@
+#include "paletteServer.h"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLocalSocket>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstring>
+
+using namespace Qt::Literals::StringLiterals;
+
+class PaletteServerTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void init();
+    void cleanup();
+    void testSnapshotOnConnect();
+    void testUpdates();
+    void testPalettesNeeded();
+    void testSlowSubscriber();
+    void testSocketInUse();
+    void testStaleSocket();
+
+private:
+    static std::array<Palette, PaletteCount> makePalettes(const QColor &accent);
+    std::unique_ptr<QLocalSocket> connectSubscriber();
+    // the next line a subscriber got, parsed
+    static QJsonObject readMessage(QLocalSocket &socket);
+
+    QTemporaryDir dir;
+    std::unique_ptr<PaletteServer> server;
+};
+
+void PaletteServerTest::init()
+{
+    QVERIFY(dir.isValid());
+    server = std::make_unique<PaletteServer>();
+    QVERIFY(server->listen(dir.filePath(QStringLiteral("socket"))));
+}
+
+void PaletteServerTest::cleanup()
+{
+    server.reset();
+}
+
+std::array<Palette, PaletteCount> PaletteServerTest::makePalettes(const QColor &accent)
+{
+    std::array<Palette, PaletteCount> palettes;
+    palettes[KdePalette].append("accent"_L1, accent);
+    palettes[KdePalette].append("window"_L1, QColor(239, 240, 241));
+    palettes[DiscordPalette].append("brand-500"_L1, QColor(61, 174, 233));
+    return palettes;
+}
+
+std::unique_ptr<QLocalSocket> PaletteServerTest::connectSubscriber()
+{
+    auto socket = std::make_unique<QLocalSocket>();
+    socket->connectToServer(server->fullServerName());
+    if (!socket->waitForConnected(5000)) {
+        return nullptr;
+    }
+    return socket;
+}
+
+QJsonObject PaletteServerTest::readMessage(QLocalSocket &socket)
+{
+    const bool ready = QTest::qWaitFor(
+        [&socket]() {
+            return socket.canReadLine();
+        },
+        5000);
+    if (!ready) {
+        return QJsonObject();
+    }
+    return QJsonDocument::fromJson(socket.readLine()).object();
+}
+
+void PaletteServerTest::testSnapshotOnConnect()
+{
+    server->publish(makePalettes(QColor(61, 174, 233)));
+    QCOMPARE(server->version(), quint64(1));
+
+    const std::unique_ptr<QLocalSocket> socket = connectSubscriber();
+    QVERIFY(socket);
+    const QJsonObject snapshot = readMessage(*socket);
+    QCOMPARE(snapshot["type"_L1].toString(), u"snapshot"_s);
+    QCOMPARE(snapshot["version"_L1].toInteger(), qint64(1));
+
+    const QJsonObject palettes = snapshot["palettes"_L1].toObject();
+    QCOMPARE(palettes["kde"_L1].toObject(), (QJsonObject{{u"accent"_s, u"#3daee9"_s}, {u"window"_s, u"#eff0f1"_s}}));
+    QCOMPARE(palettes["discord"_L1].toObject(), (QJsonObject{{u"brand-500"_s, u"#3daee9"_s}}));
+    QVERIFY(palettes["ramps"_L1].toObject().isEmpty());
+    QCOMPARE(server->subscriberCount(), qsizetype(1));
+}
+
+void PaletteServerTest::testUpdates()
+{
+    server->publish(makePalettes(QColor(61, 174, 233)));
+    const std::unique_ptr<QLocalSocket> socket = connectSubscriber();
+    QVERIFY(socket);
+    QCOMPARE(readMessage(*socket)["type"_L1].toString(), u"snapshot"_s);
+
+    // only the accent changed
+    server->publish(makePalettes(QColor(233, 100, 61)));
+    QJsonObject update = readMessage(*socket);
+    QCOMPARE(update["type"_L1].toString(), u"update"_s);
+    QCOMPARE(update["version"_L1].toInteger(), qint64(2));
+    QCOMPARE(update["palettes"_L1].toObject(), (QJsonObject{{u"kde"_s, QJsonObject{{u"accent"_s, u"#e9643d"_s}}}}));
+    QVERIFY(!update.contains("removed"_L1));
+
+    // same colors, nothing is sent
+    server->publish(makePalettes(QColor(233, 100, 61)));
+    QCOMPARE(server->version(), quint64(2));
+
+    std::array<Palette, PaletteCount> palettes = makePalettes(QColor(233, 100, 61));
+    palettes[DiscordPalette] = Palette();
+    palettes[DiscordPalette].append("brand-600"_L1, QColor(0, 0, 0));
+    server->publish(palettes);
+    update = readMessage(*socket);
+    QCOMPARE(update["version"_L1].toInteger(), qint64(3));
+    QCOMPARE(update["palettes"_L1].toObject(), (QJsonObject{{u"discord"_s, QJsonObject{{u"brand-600"_s, u"#000000"_s}}}}));
+    QCOMPARE(update["removed"_L1].toObject(), (QJsonObject{{u"discord"_s, QJsonArray{u"brand-500"_s}}}));
+    QVERIFY(!socket->canReadLine());
+
+    // a late subscriber starts from the latest state
+    const std::unique_ptr<QLocalSocket> late = connectSubscriber();
+    QVERIFY(late);
+    const QJsonObject snapshot = readMessage(*late);
+    QCOMPARE(snapshot["version"_L1].toInteger(), qint64(3));
+    QCOMPARE(snapshot["palettes"_L1].toObject()["discord"_L1].toObject(), (QJsonObject{{u"brand-600"_s, u"#000000"_s}}));
+}
+
+void PaletteServerTest::testPalettesNeeded()
+{
+    QSignalSpy needed(server.get(), &PaletteServer::palettesNeeded);
+    const std::unique_ptr<QLocalSocket> socket = connectSubscriber();
+    QVERIFY(socket);
+    QVERIFY(needed.wait(5000));
+
+    // the subscriber that asked gets a snapshot, not an update
+    server->publish(makePalettes(QColor(61, 174, 233)));
+    const QJsonObject snapshot = readMessage(*socket);
+    QCOMPARE(snapshot["type"_L1].toString(), u"snapshot"_s);
+    QCOMPARE(snapshot["version"_L1].toInteger(), qint64(1));
+}
+
+void PaletteServerTest::testSlowSubscriber()
+{
+    server->publish(makePalettes(QColor(0, 0, 0)));
+    const std::unique_ptr<QLocalSocket> socket = connectSubscriber();
+    QVERIFY(socket);
+    QTRY_COMPARE(server->subscriberCount(), qsizetype(1));
+
+    // never reads, the socket buffer and then the server's write buffer fill up
+    for (int i = 1; i < 200000 && server->subscriberCount() > 0; i++) {
+        server->publish(makePalettes(QColor::fromRgb(i * 7919 & 0xffffff)));
+    }
+    QCOMPARE(server->subscriberCount(), qsizetype(0));
+    QCOMPARE(server->droppedSubscriberCount(), quint64(1));
+}
+
+void PaletteServerTest::testSocketInUse()
+{
+    server->publish(makePalettes(QColor(61, 174, 233)));
+
+    // a second instance leaves the first one alone
+    PaletteServer second;
+    QVERIFY(!second.listen(server->fullServerName()));
+
+    const std::unique_ptr<QLocalSocket> socket = connectSubscriber();
+    QVERIFY(socket);
+    QCOMPARE(readMessage(*socket)["type"_L1].toString(), u"snapshot"_s);
+}
+
+void PaletteServerTest::testStaleSocket()
+{
+    // what a crashed instance leaves behind: the socket file, with nothing listening
+    const QByteArray path = QFile::encodeName(dir.filePath(QStringLiteral("stale")));
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    QVERIFY(size_t(path.size()) < sizeof(address.sun_path));
+    std::memcpy(address.sun_path, path.constData(), path.size());
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    QVERIFY(fd >= 0);
+    QCOMPARE(::bind(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)), 0);
+    ::close(fd);
+    QVERIFY(QFile::exists(QFile::decodeName(path)));
+
+    PaletteServer replacement;
+    QVERIFY(replacement.listen(QFile::decodeName(path)));
+    replacement.publish(makePalettes(QColor(61, 174, 233)));
+
+    QLocalSocket socket;
+    socket.connectToServer(replacement.fullServerName());
+    QVERIFY(socket.waitForConnected(5000));
+    QCOMPARE(readMessage(socket)["type"_L1].toString(), u"snapshot"_s);
+}
+
+QTEST_GUILESS_MAIN(PaletteServerTest)
+
+#include "paletteServerTest.moc"
@@ -0,0 +1,295 @@
+#include "allocationCounter.h"
+#include "palette.h"
+
+#include <QTemporaryDir>
+#include <QTest>
+
+#include <KColorUtils>
+
+class PaletteTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void testKdePalette();
+    void testHeaderlessFallback();
+    void testDiscordPalette();
+    void testRampPalette();
+    void testConfiguredRamps();
+    void testSortedAndUnique();
+    void testPaletteHasColor();
+    void testEquality();
+    void testPaletteInputsOf();
+    void testUpdatePalette_data();
+    void testUpdatePalette();
+    void testNoAllocations();
+
+private:
+    QTemporaryDir dir;
+    KSharedConfigPtr config;
+    KSharedConfigPtr headerlessConfig;
+};
+
+static QColor colorOf(const Palette &palette, const char *name)
+{
+    const QColor *color = palette.find(QLatin1StringView(name));
+    return color ? *color : QColor();
+}
+
+void PaletteTest::initTestCase()
+{
+    // color effects are disabled in the fixtures, so every state uses the colors as written
+    config = KSharedConfig::openConfig(QFINDTESTDATA("data/kdeglobals"), KConfig::SimpleConfig);
+    headerlessConfig = KSharedConfig::openConfig(QFINDTESTDATA("data/kdeglobals-noheader"), KConfig::SimpleConfig);
+}
+
+void PaletteTest::testKdePalette()
+{
+    const ColorSchemeSet schemes(config);
+    QVERIFY(schemes.hasHeaderColors());
+
+    const Palette palette = computeKdePalette(schemes);
+    QCOMPARE(palette.size(), qsizetype(84));
+
+    QCOMPARE(colorOf(palette, "theme-fg-color-breeze"), QColor(35, 36, 41));
+    QCOMPARE(colorOf(palette, "theme-bg-color-breeze"), QColor(239, 240, 241));
+    QCOMPARE(colorOf(palette, "theme-base-color-breeze"), QColor(255, 255, 255));
+    QCOMPARE(colorOf(palette, "theme-selected-bg-color-breeze"), QColor(61, 174, 233));
+    QCOMPARE(colorOf(palette, "theme-button-decoration-focus-breeze"), QColor(61, 174, 233));
+    QCOMPARE(colorOf(palette, "error-color-breeze"), QColor(218, 68, 83));
+    QCOMPARE(colorOf(palette, "link-color-breeze"), QColor(41, 128, 185));
+    QCOMPARE(colorOf(palette, "borders-breeze"), KColorUtils::mix(QColor(239, 240, 241), QColor(35, 36, 41), 0.25));
+    QCOMPARE(colorOf(palette, "tooltip-border-breeze"), KColorUtils::mix(QColor(247, 247, 247), QColor(35, 38, 43), 0.25));
+
+    // the Header color set is used for both headers and titlebars
+    QCOMPARE(colorOf(palette, "theme-header-background-breeze"), QColor(222, 224, 226));
+    QCOMPARE(colorOf(palette, "theme-titlebar-background-breeze"), QColor(222, 224, 226));
+    QCOMPARE(colorOf(palette, "theme-header-background-backdrop-breeze"), QColor(239, 240, 241));
+}
+
+void PaletteTest::testHeaderlessFallback()
+{
+    const ColorSchemeSet schemes(headerlessConfig);
+    QVERIFY(!schemes.hasHeaderColors());
+
+    const Palette palette = computeKdePalette(schemes);
+    QCOMPARE(palette.size(), qsizetype(84));
+
+    // headers fall back to the window colors and titlebars to the [WM] group
+    QCOMPARE(colorOf(palette, "theme-header-background-breeze"), QColor(239, 240, 241));
+    QCOMPARE(colorOf(palette, "theme-header-foreground-breeze"), QColor(35, 36, 41));
+    QCOMPARE(colorOf(palette, "theme-titlebar-background-breeze"), QColor(71, 80, 87));
+    QCOMPARE(colorOf(palette, "theme-titlebar-foreground-breeze"), QColor(252, 252, 252));
+    QCOMPARE(colorOf(palette, "theme-titlebar-foreground-backdrop-breeze"), QColor(161, 169, 177));
+}
+
+void PaletteTest::testDiscordPalette()
+{
+    const ColorSchemeSet schemes(config);
+    const Palette palette = computeDiscordPalette(schemes);
+    QCOMPARE(palette.size(), qsizetype(20 + 2 * 27));
+
+    QCOMPARE(colorOf(palette, "background-primary"), QColor(227, 229, 231));
+    QCOMPARE(colorOf(palette, "background-tertiary"), QColor(247, 247, 247));
+    QCOMPARE(colorOf(palette, "scrollbar-thin-thumb"), QColor(61, 174, 233));
+
+    const QColor accent(61, 174, 233);
+    QCOMPARE(colorOf(palette, "brand-100").rgb(), QColor::fromHsl(accent.hslHue(), accent.hslSaturation(), 226).rgb());
+    QCOMPARE(colorOf(palette, "brand-500").rgb(), QColor::fromHsl(accent.hslHue(), accent.hslSaturation(), 113).rgb());
+    QCOMPARE(colorOf(palette, "brand-900").rgb(), QColor::fromHsl(accent.hslHue(), accent.hslSaturation(), 0).rgb());
+    QVERIFY(colorOf(palette, "primary-100").isValid());
+    QVERIFY(colorOf(palette, "primary-900").isValid());
+}
+
+void PaletteTest::testRampPalette()
+{
+    const ColorSchemeSet schemes(config);
+    const Palette palette = computeRampPalette(schemes, RampSettings());
+    QCOMPARE(palette.size(), qsizetype(110));
+
+    for (const char *role : {"accent", "window", "view", "text", "active", "link", "visited", "positive", "neutral", "negative"}) {
+        int previousGray = 256;
+        for (int stop : {50, 100, 200, 300, 400, 500, 600, 700, 800, 900, 950}) {
+            const QByteArray name = QByteArray(role) + '-' + QByteArray::number(stop);
+            const QColor *color = palette.find(QLatin1StringView(name));
+            QVERIFY2(color, name.constData());
+            // lightest first
+            QVERIFY2(qGray(color->rgb()) <= previousGray, name.constData());
+            previousGray = qGray(color->rgb());
+        }
+    }
+}
+
+void PaletteTest::testConfiguredRamps()
+{
+    RampSettings ramps;
+    ramps.roles = (1 << 0) | (1 << 5);
+    ramps.stops = {150, 500, 850};
+    ramps.stopCount = 3;
+    ramps.space = ShadeRamp::Hsl;
+    QCOMPARE(rampRoleName(0), QLatin1StringView("accent"));
+    QCOMPARE(rampRoleName(5), QLatin1StringView("link"));
+
+    const ColorSchemeSet schemes(config);
+    const Palette palette = computeRampPalette(schemes, ramps);
+    QCOMPARE(palette.size(), qsizetype(6));
+    for (const Palette::Entry &entry : palette) {
+        QVERIFY2(paletteHasColor(RampPalette, entry.name, ramps), qPrintable(entry.name.toString()));
+    }
+    QVERIFY(!paletteHasColor(RampPalette, QLatin1StringView("accent-50"), ramps));
+    QVERIFY(!paletteHasColor(RampPalette, QLatin1StringView("view-500"), ramps));
+
+    // hsl keeps the hue of the accent
+    const QColor accent = *computeKdePalette(schemes).find(QLatin1StringView("theme-selected-bg-color-breeze"));
+    QCOMPARE(colorOf(palette, "accent-500").hslHue(), accent.hslHue());
+    QVERIFY(qGray(colorOf(palette, "accent-150").rgb()) > qGray(colorOf(palette, "accent-850").rgb()));
+
+    // only the configured ones are computed again
+    Palette updated = palette;
+    QCOMPARE(updatePalette(RampPalette, schemes, ramps, AllPaletteInputs, updated), 6);
+    QVERIFY(updated == palette);
+
+    // every role and stop fits
+    ramps.roles = (1 << RampSettings::RoleCount) - 1;
+    for (int i = 0; i < RampSettings::MaxStops; i++) {
+        ramps.stops[i] = (i + 1) * RampSettings::StopStep;
+    }
+    ramps.stopCount = RampSettings::MaxStops;
+    QCOMPARE(computeRampPalette(schemes, ramps).size(), qsizetype(190));
+}
+
+void PaletteTest::testSortedAndUnique()
+{
+    const ColorSchemeSet schemes(config);
+    for (const Palette &palette : {computeKdePalette(schemes), computeDiscordPalette(schemes), computeRampPalette(schemes, RampSettings())}) {
+        for (const Palette::Entry *entry = palette.begin() + 1; entry < palette.end(); entry++) {
+            QVERIFY2((entry - 1)->name < entry->name, qPrintable(entry->name.toString()));
+        }
+    }
+}
+
+void PaletteTest::testPaletteHasColor()
+{
+    const ColorSchemeSet schemes(config);
+    for (int id = 0; id < PaletteCount; id++) {
+        const Palette palette = computePalette(PaletteId(id), schemes, RampSettings());
+        for (const Palette::Entry &entry : palette) {
+            QVERIFY2(paletteHasColor(PaletteId(id), entry.name, RampSettings()), qPrintable(entry.name.toString()));
+        }
+    }
+
+    QVERIFY(!paletteHasColor(KdePalette, QLatin1StringView("brand-500"), RampSettings()));
+    QVERIFY(!paletteHasColor(DiscordPalette, QLatin1StringView("link-color-breeze"), RampSettings()));
+    QVERIFY(!paletteHasColor(RampPalette, QLatin1StringView("accent-55"), RampSettings()));
+    QVERIFY(!paletteHasColor(RampPalette, QLatin1StringView("accent-150"), RampSettings()));
+    QVERIFY(!paletteHasColor(KdePalette, QLatin1StringView("link-color"), RampSettings()));
+}
+
+void PaletteTest::testEquality()
+{
+    const ColorSchemeSet schemes(config);
+    const ColorSchemeSet headerless(KSharedConfig::openConfig(QFINDTESTDATA("data/kdeglobals-noheader"), KConfig::SimpleConfig));
+
+    QVERIFY(computeKdePalette(schemes) == computeKdePalette(schemes));
+    QVERIFY(!(computeKdePalette(schemes) == computeKdePalette(headerless)));
+    QVERIFY(!(computeKdePalette(schemes) == computeDiscordPalette(schemes)));
+    QVERIFY(Palette() == Palette());
+}
+
+void PaletteTest::testPaletteInputsOf()
+{
+    QCOMPARE(paletteInputsOf(QStringLiteral("General"), {"AccentColor"}), PaletteInputs(AccentColorInput));
+    QCOMPARE(paletteInputsOf(QStringLiteral("General"), {"ColorScheme", "AccentColor"}), PaletteInputs(AllPaletteInputs));
+    QCOMPARE(paletteInputsOf(QStringLiteral("General"), {"font"}), PaletteInputs(0));
+    QCOMPARE(paletteInputsOf(QStringLiteral("General"), {"font", "AccentColor"}), PaletteInputs(AccentColorInput));
+    QVERIFY(paletteInputsOf(QStringLiteral("General"), {"accentActiveTitlebar"}) & WindowManagerInput);
+    QCOMPARE(paletteInputsOf(QStringLiteral("General"), {"TintFactor"}), PaletteInputs(AllPaletteInputs));
+    // a key it doesn't know about could be a new color setting
+    QCOMPARE(paletteInputsOf(QStringLiteral("General"), {"SomethingNew"}), PaletteInputs(AllPaletteInputs));
+    QCOMPARE(paletteInputsOf(QStringLiteral("Colors:Selection"), {"BackgroundNormal"}), PaletteInputs(SelectionColorsInput));
+    QCOMPARE(paletteInputsOf(QStringLiteral("Colors:Header"), {"BackgroundNormal"}), PaletteInputs(HeaderColorsInput));
+    QCOMPARE(paletteInputsOf(QStringLiteral("Colors:Unknown"), {"BackgroundNormal"}), PaletteInputs(AllPaletteInputs));
+    QCOMPARE(paletteInputsOf(QStringLiteral("ColorEffects:Disabled"), {"Color"}), PaletteInputs(DisabledEffectsInput));
+    QCOMPARE(paletteInputsOf(QStringLiteral("WM"), {"activeBackground"}), PaletteInputs(WindowManagerInput));
+    QCOMPARE(paletteInputsOf(QStringLiteral("KDE"), {"SingleClick"}), PaletteInputs(0));
+}
+
+void PaletteTest::testUpdatePalette_data()
+{
+    QTest::addColumn<int>("id");
+    QTest::addColumn<QString>("group");
+    QTest::addColumn<QByteArray>("key");
+    QTest::addColumn<QString>("value");
+    // whether only some of the colors should be computed again
+    QTest::addColumn<bool>("partial");
+
+    for (int id : {KdePalette, DiscordPalette, RampPalette}) {
+        const QByteArray palette = QByteArray::number(id);
+        QTest::newRow((palette + " accent").constData()) << id << QStringLiteral("General") << QByteArray("AccentColor") << QStringLiteral("233,100,61") << true;
+        QTest::newRow((palette + " selection").constData())
+            << id << QStringLiteral("Colors:Selection") << QByteArray("BackgroundNormal") << QStringLiteral("10,20,30") << true;
+        QTest::newRow((palette + " view").constData()) << id << QStringLiteral("Colors:View") << QByteArray("BackgroundAlternate") << QStringLiteral("10,20,30") << true;
+        QTest::newRow((palette + " link").constData()) << id << QStringLiteral("Colors:View") << QByteArray("ForegroundLink") << QStringLiteral("10,20,30") << true;
+        QTest::newRow((palette + " header").constData()) << id << QStringLiteral("Colors:Header") << QByteArray("BackgroundNormal") << QStringLiteral("10,20,30") << true;
+        // the other [General] keys the colors can depend on
+        QTest::newRow((palette + " accent titlebar").constData()) << id << QStringLiteral("General") << QByteArray("accentActiveTitlebar") << QStringLiteral("true")
+                                                                  << false;
+        QTest::newRow((palette + " tint").constData()) << id << QStringLiteral("General") << QByteArray("TintFactor") << QStringLiteral("0.5") << false;
+    }
+}
+
+void PaletteTest::testUpdatePalette()
+{
+    QFETCH(int, id);
+    QFETCH(QString, group);
+    QFETCH(QByteArray, key);
+    QFETCH(QString, value);
+    QFETCH(bool, partial);
+
+    // a copy per row, KSharedConfig would hand out the same object for the same file
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath(QString::fromLatin1(QTest::currentDataTag()));
+    QVERIFY(QFile::copy(QFINDTESTDATA("data/kdeglobals"), path));
+    const KSharedConfigPtr changedConfig = KSharedConfig::openConfig(path, KConfig::SimpleConfig);
+
+    // an empty palette is computed in full
+    Palette palette;
+    const int computed = updatePalette(PaletteId(id), ColorSchemeSet(changedConfig), RampSettings(), 0, palette);
+    QCOMPARE(computed, int(palette.size()));
+
+    changedConfig->group(group).writeEntry(key.constData(), value);
+    const ColorSchemeSet schemes(changedConfig);
+    const Palette expected = computePalette(PaletteId(id), schemes, RampSettings());
+    const int recomputed = updatePalette(PaletteId(id), schemes, RampSettings(), paletteInputsOf(group, {key}), palette);
+
+    // the same colors as computing everything again, from a fraction of the work
+    QVERIFY(palette == expected);
+    if (partial) {
+        QVERIFY2(recomputed < palette.size(), qPrintable(QString::number(recomputed)));
+    }
+}
+
+void PaletteTest::testNoAllocations()
+{
+    if (!AllocationCounter::isSupported()) {
+        QSKIP("Allocations can only be counted with glibc");
+    }
+
+    // building the schemes allocates inside KColorScheme, filling the palettes must not
+    const ColorSchemeSet schemes(config);
+
+    AllocationCounter counter;
+    const Palette kde = computeKdePalette(schemes);
+    const Palette discord = computeDiscordPalette(schemes);
+    const Palette ramps = computeRampPalette(schemes, RampSettings());
+    QCOMPARE(counter.count(), quint64(0));
+
+    QCOMPARE(kde.size(), qsizetype(84));
+    QCOMPARE(discord.size(), qsizetype(74));
+    QCOMPARE(ramps.size(), qsizetype(110));
+}
+
+QTEST_GUILESS_MAIN(PaletteTest)
+
+#include "paletteTest.moc"
@@ -0,0 +1,315 @@
+#include "eventTrace.h"
+#include "kolorExporter.h"
+#include "targetRegistry.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QSignalSpy>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include <KConfigGroup>
+
+#include <algorithm>
+
+// Replays a recorded kdeglobals trace (see EventRecorder) into the module, in a
+// sandbox, several times in a row. Fails if memory or file descriptors keep
+// growing, or if the files don't match the colors the trace ends with.
+//
+// KOLOR_EXPORTER_TRACE             the trace, data/events.jsonl by default
+// KOLOR_EXPORTER_REPLAY_SPEED      1 for the recorded timing, 10 for 10 times faster, or 0
+//                                  (the default) for each event as soon as the last one is on disk
+// KOLOR_EXPORTER_REPLAY_PASSES     how many times the trace is replayed, 5 by default
+// KOLOR_EXPORTER_MAX_RSS_GROWTH    KiB the RSS may grow after the first pass, 4096 by default
+class ReplaySoakTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+    void testReplay();
+
+private:
+    struct PendingEvent {
+        qint64 fedAt = 0;
+        // of the export that picked it up, 0 until one did
+        quint64 generation = 0;
+    };
+
+    // the trace once over, starting from its kdeglobals
+    void replay();
+    void feed(const ConfigChangeEvent &event);
+    bool waitForExports();
+    // every target has what the current kdeglobals says it should
+    void verifyOutputs();
+
+    static qint64 residentKiB();
+    static qsizetype openFileDescriptors();
+    static qint64 percentile(QList<qint64> latencies, int percent);
+
+    QTemporaryDir home;
+    EventTrace trace;
+    double speed = 0;
+    int passes = 5;
+    qint64 maxRssGrowth = 4096;
+
+    KSharedConfigPtr kdeglobals;
+    std::unique_ptr<kolorExporter> module;
+    QElapsedTimer clock;
+    QList<PendingEvent> pending;
+    // event to file of the current pass, only the events that changed an input
+    QList<qint64> latencies;
+};
+
+void ReplaySoakTest::initTestCase()
+{
+    QVERIFY(home.isValid());
+    qputenv("HOME", QFile::encodeName(home.path()));
+    // the module would replace the session's socket otherwise
+    const QString runtimeDir = home.filePath(QStringLiteral("runtime"));
+    QVERIFY(QDir().mkpath(runtimeDir));
+    QVERIFY(QFile::setPermissions(runtimeDir, QFile::ReadOwner | QFile::WriteOwner | QFile::ExeOwner));
+    qputenv("XDG_RUNTIME_DIR", QFile::encodeName(runtimeDir));
+    QStandardPaths::setTestModeEnabled(true);
+
+    const QString tracePath = qEnvironmentVariableIsSet("KOLOR_EXPORTER_TRACE") ? qEnvironmentVariable("KOLOR_EXPORTER_TRACE") : QFINDTESTDATA("data/events.jsonl");
+    std::optional<EventTrace> loaded = EventTrace::load(tracePath);
+    QVERIFY(loaded);
+    trace = std::move(*loaded);
+    if (qEnvironmentVariableIsSet("KOLOR_EXPORTER_REPLAY_SPEED")) {
+        speed = qEnvironmentVariable("KOLOR_EXPORTER_REPLAY_SPEED").toDouble();
+    }
+    if (qEnvironmentVariableIsSet("KOLOR_EXPORTER_REPLAY_PASSES")) {
+        passes = qEnvironmentVariableIntValue("KOLOR_EXPORTER_REPLAY_PASSES");
+    }
+    if (qEnvironmentVariableIsSet("KOLOR_EXPORTER_MAX_RSS_GROWTH")) {
+        maxRssGrowth = qEnvironmentVariableIntValue("KOLOR_EXPORTER_MAX_RSS_GROWTH");
+    }
+    QVERIFY(speed >= 0);
+    QVERIFY(passes > 0);
+
+    const QString configDir = QStandardPaths::writableLocation(QStandardPaths::GenericConfigLocation);
+    QDir(configDir).removeRecursively();
+    QDir(QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)).removeRecursively();
+    QVERIFY(QDir().mkpath(configDir));
+
+    QFile file(configDir + QStringLiteral("/kdeglobals"));
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    QVERIFY(file.write(trace.kdeglobals) == trace.kdeglobals.size());
+    file.close();
+
+    // every palette, and a link, with a delay short enough to not slow the replay
+    // down but long enough to still merge bursts. Only these, the built in ones
+    // depend on what's installed
+    const QByteArray out = QFile::encodeName(home.filePath(QStringLiteral("out")));
+    QFile exporterConfig(configDir + QStringLiteral("/kolorexporterrc"));
+    QVERIFY(exporterConfig.open(QIODevice::WriteOnly));
+    exporterConfig.write("[General]\nExportDelay=10\n\n");
+    for (const char *builtIn : {"kde-colors", "rofi", "vencord", "vencord-flatpak", "vesktop", "vesktop-flatpak"}) {
+        exporterConfig.write("[Targets][" + QByteArray(builtIn) + "]\nEnabled=false\n\n");
+    }
+    exporterConfig.write("[Targets][soak-css]\nPath=" + out + "/colors.css\nTemplate=css\nPalette=kde\n\n"
+                         "[Targets][soak-kitty]\nPath=" + out + "/kitty.conf\nTemplate=kitty\nPalette=kde\n\n"
+                         "[Targets][soak-vencord]\nPath=" + out + "/vencord.css\nTemplate=vencord\nPalette=discord\n\n"
+                         "[Targets][soak-ramps]\nPath=" + out + "/ramps.json\nTemplate=json\nPalette=ramps\n\n"
+                         "[Targets][soak-link]\nPath=" + out + "/link.css\nTemplate=css\nPalette=kde\nLink=true\n");
+    exporterConfig.close();
+    QVERIFY(QDir().mkpath(home.filePath(QStringLiteral("out"))));
+
+    kdeglobals = KSharedConfig::openConfig();
+    module = std::make_unique<kolorExporter>(nullptr, QVariantList());
+    connect(module.get(), &kolorExporter::exportStarted, this, [this](quint64 generation) {
+        for (PendingEvent &event : pending) {
+            if (event.generation == 0) {
+                event.generation = generation;
+            }
+        }
+    });
+    connect(module.get(), &kolorExporter::exportFinished, this, [this](quint64 generation, bool cancelled) {
+        // the export that replaced it has the same changes and the newer ones
+        if (cancelled) {
+            return;
+        }
+        const qint64 now = clock.nsecsElapsed();
+        pending.removeIf([this, generation, now](const PendingEvent &event) {
+            if (event.generation == 0 || event.generation > generation) {
+                return false;
+            }
+            latencies.append(now - event.fedAt);
+            return true;
+        });
+    });
+    clock.start();
+
+    // the startup export, nothing is cached in the sandbox
+    QSignalSpy finished(module.get(), &kolorExporter::exportFinished);
+    QVERIFY(finished.wait(30000));
+}
+
+void ReplaySoakTest::cleanupTestCase()
+{
+    module.reset();
+}
+
+void ReplaySoakTest::feed(const ConfigChangeEvent &event)
+{
+    // what KConfigWatcher does before notifying: the file is written and the config reparsed
+    const KConfigGroup group = event.apply(*kdeglobals, KConfig::Global);
+    QVERIFY(kdeglobals->sync());
+
+    // the others don't start an export, so they'd never be done
+    if (paletteInputsOf(event.group.first(), event.names) != 0) {
+        pending.append(PendingEvent{clock.nsecsElapsed(), 0});
+    }
+    module->onKdeglobalsSettingsChange(group, event.names);
+}
+
+bool ReplaySoakTest::waitForExports()
+{
+    return QTest::qWaitFor(
+        [this]() {
+            return pending.isEmpty();
+        },
+        30000);
+}
+
+void ReplaySoakTest::replay()
+{
+    // like switching to the color scheme the trace started with
+    {
+        QFile file(QStandardPaths::writableLocation(QStandardPaths::GenericConfigLocation) + QStringLiteral("/kdeglobals"));
+        QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+        QVERIFY(file.write(trace.kdeglobals) == trace.kdeglobals.size());
+    }
+    kdeglobals->reparseConfiguration();
+    feed(ConfigChangeEvent{0, {QStringLiteral("General")}, {QByteArrayLiteral("ColorScheme")}, {kdeglobals->group(QStringLiteral("General")).readEntry("ColorScheme")}});
+    QVERIFY(waitForExports());
+
+    const qint64 traceStart = clock.nsecsElapsed();
+    const qint64 firstTime = trace.events.isEmpty() ? 0 : trace.events.first().time;
+    for (const ConfigChangeEvent &event : std::as_const(trace.events)) {
+        if (speed > 0) {
+            const qint64 due = traceStart + qint64((event.time - firstTime) * 1000000 / speed);
+            const qint64 wait = (due - clock.nsecsElapsed()) / 1000000;
+            if (wait > 0) {
+                QTest::qWait(int(wait));
+            }
+        } else {
+            // as fast as the module keeps up
+            QVERIFY(waitForExports());
+        }
+        feed(event);
+        if (QTest::currentTestFailed()) {
+            return;
+        }
+    }
+    QVERIFY(waitForExports());
+}
+
+void ReplaySoakTest::verifyOutputs()
+{
+    const ColorSchemeSet schemes(kdeglobals);
+    TargetRegistry registry;
+    registry.setTargets(loadExportTargets(KSharedConfig::openConfig(QStringLiteral("kolorexporterrc"))));
+    const QList<ExportTarget> targets = registry.availableTargets();
+    QCOMPARE(targets.size(), qsizetype(5));
+
+    for (const ExportTarget &target : targets) {
+        QByteArray expected;
+        target.outputTemplate->render(computePalette(target.palette, schemes, RampSettings()), expected);
+        QFile file(target.path);
+        QVERIFY2(file.open(QIODevice::ReadOnly), qPrintable(target.path));
+        QVERIFY2(file.readAll() == expected, qPrintable(target.name + QStringLiteral(" drifted from the final palette")));
+    }
+}
+
+void ReplaySoakTest::testReplay()
+{
+    if (residentKiB() < 0) {
+        QSKIP("needs /proc");
+    }
+
+    qint64 baselineRss = 0;
+    qsizetype baselineFds = 0;
+    qsizetype totalEvents = 0;
+    qint64 totalNanoseconds = 0;
+    QList<qint64> allLatencies;
+
+    for (int pass = 1; pass <= passes; pass++) {
+        latencies.clear();
+        const qint64 start = clock.nsecsElapsed();
+        replay();
+        if (QTest::currentTestFailed()) {
+            return;
+        }
+        verifyOutputs();
+        if (QTest::currentTestFailed()) {
+            return;
+        }
+
+        // and the scheme switch at the start
+        const qsizetype events = trace.events.size() + 1;
+        const qint64 elapsed = clock.nsecsElapsed() - start;
+        const qint64 rss = residentKiB();
+        const qsizetype fds = openFileDescriptors();
+        qInfo().nospace() << "pass " << pass << ": " << events << " events, " << events * 1e9 / elapsed << " events/s, p50 "
+                          << percentile(latencies, 50) / 1000 << " us, p99 " << percentile(latencies, 99) / 1000
+                          << " us, rss " << rss << " KiB, " << fds << " fds";
+
+        // the first pass fills the caches and pools, everything after it should be steady
+        if (pass == 1) {
+            baselineRss = rss;
+            baselineFds = fds;
+        } else {
+            QVERIFY2(rss - baselineRss <= maxRssGrowth, qPrintable(QStringLiteral("RSS grew by %1 KiB since the first pass").arg(rss - baselineRss)));
+            QCOMPARE(fds, baselineFds);
+        }
+
+        totalEvents += events;
+        totalNanoseconds += elapsed;
+        allLatencies.append(latencies);
+    }
+
+    const QVariantMap metrics = module->metrics();
+    qInfo().nospace() << "total: " << totalEvents << " events, " << totalEvents * 1e9 / totalNanoseconds << " events/s, p50 "
+                      << percentile(allLatencies, 50) / 1000 << " us, p99 " << percentile(allLatencies, 99) / 1000 << " us, "
+                      << metrics.value(QStringLiteral("exports")).toULongLong() << " exports, "
+                      << metrics.value(QStringLiteral("cancelledExports")).toULongLong() << " cancelled";
+}
+
+qint64 ReplaySoakTest::residentKiB()
+{
+    QFile status(QStringLiteral("/proc/self/status"));
+    if (!status.open(QIODevice::ReadOnly)) {
+        return -1;
+    }
+    while (!status.atEnd()) {
+        const QByteArray line = status.readLine();
+        // "VmRSS:     12345 kB"
+        if (line.startsWith("VmRSS:")) {
+            return line.mid(6).trimmed().split(' ').first().toLongLong();
+        }
+    }
+    return -1;
+}
+
+qsizetype ReplaySoakTest::openFileDescriptors()
+{
+    // the sockets and pipes are broken symlinks, System lists them too
+    return QDir(QStringLiteral("/proc/self/fd")).entryList(QDir::AllEntries | QDir::System | QDir::NoDotAndDotDot).size();
+}
+
+qint64 ReplaySoakTest::percentile(QList<qint64> latencies, int percent)
+{
+    if (latencies.isEmpty()) {
+        return 0;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    return latencies.at(std::min(latencies.size() - 1, latencies.size() * percent / 100));
+}
+
+QTEST_GUILESS_MAIN(ReplaySoakTest)
+
+#include "replaySoakTest.moc"
@@ -0,0 +1,142 @@
+#include "goldenFile.h"
+#include "schemeBatch.h"
+
+#include <QDir>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include <KConfigGroup>
+
+class SchemeBatchTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void testFindSchemes();
+    void testBatch();
+
+private:
+    SchemeBatch::Result runBatch(SchemeBatch &batch, const QStringList &schemes);
+    void copyScheme(const QString &path);
+
+    QTemporaryDir dir;
+    QStringList directories;
+    SchemeExportSettings settings;
+};
+
+void SchemeBatchTest::initTestCase()
+{
+    QVERIFY(dir.isValid());
+    directories = {dir.filePath(QStringLiteral("user/color-schemes")), dir.filePath(QStringLiteral("system/color-schemes"))};
+    for (const QString &directory : std::as_const(directories)) {
+        QVERIFY(QDir().mkpath(directory));
+    }
+
+    copyScheme(directories[0] + QStringLiteral("/Breeze.colors"));
+    copyScheme(directories[0] + QStringLiteral("/Other.colors"));
+    // hidden by the user one with the same name
+    copyScheme(directories[1] + QStringLiteral("/Breeze.colors"));
+    copyScheme(directories[1] + QStringLiteral("/System.colors"));
+    QFile notAScheme(directories[1] + QStringLiteral("/README"));
+    QVERIFY(notAScheme.open(QIODevice::WriteOnly));
+
+    settings.directory = dir.filePath(QStringLiteral("output"));
+    settings.palette = KdePalette;
+    settings.templates.append(std::pair(QStringLiteral("css"),
+                                        std::make_shared<const OutputTemplate>(OutputTemplate::parse(":root {\n{{#colors}}    --{{name}}: {{hex}};\n{{/colors}}}\n"))));
+    settings.templates.append(std::pair(QStringLiteral("txt"), std::make_shared<const OutputTemplate>(OutputTemplate::parse("{{hex theme-bg-color-breeze}}\n"))));
+}
+
+void SchemeBatchTest::copyScheme(const QString &path)
+{
+    QFile::remove(path);
+    QVERIFY(QFile::copy(QFINDTESTDATA("data/kdeglobals"), path));
+    QVERIFY(QFile::setPermissions(path, QFile::ReadOwner | QFile::WriteOwner));
+}
+
+SchemeBatch::Result SchemeBatchTest::runBatch(SchemeBatch &batch, const QStringList &schemes)
+{
+    QSignalSpy finished(&batch, &SchemeBatch::finished);
+    batch.start(settings, schemes);
+    if (!finished.wait(30000)) {
+        return {};
+    }
+    return finished.first().first().value<SchemeBatch::Result>();
+}
+
+void SchemeBatchTest::testFindSchemes()
+{
+    QCOMPARE(SchemeBatch::findSchemes(directories),
+             (QStringList{
+                 directories[0] + QStringLiteral("/Breeze.colors"),
+                 directories[0] + QStringLiteral("/Other.colors"),
+                 directories[1] + QStringLiteral("/System.colors"),
+             }));
+    QVERIFY(SchemeBatch::findSchemes({dir.filePath(QStringLiteral("missing"))}).isEmpty());
+}
+
+void SchemeBatchTest::testBatch()
+{
+    SchemeBatch batch(dir.filePath(QStringLiteral("cache/schemes")));
+    const QString output = settings.directory;
+
+    SchemeBatch::Result result = runBatch(batch, SchemeBatch::findSchemes(directories));
+    QCOMPARE(result.exported, 3);
+    QCOMPARE(result.unchanged, 0);
+
+    QFile css(output + QStringLiteral("/Breeze.css"));
+    QVERIFY(css.open(QIODevice::ReadOnly));
+    QVERIFY(compareWithGolden(css.readAll(), QStringLiteral("kde-colors.css")));
+    for (const char *name : {"Breeze.txt", "Other.css", "Other.txt", "System.css", "System.txt"}) {
+        QVERIFY2(QFile::exists(output + QLatin1Char('/') + QLatin1StringView(name)), name);
+    }
+
+    result = runBatch(batch, SchemeBatch::findSchemes(directories));
+    QCOMPARE(result.exported, 0);
+    QCOMPARE(result.unchanged, 3);
+
+    // changed scheme
+    {
+        KConfig scheme(directories[0] + QStringLiteral("/Other.colors"), KConfig::SimpleConfig);
+        scheme.group(QStringLiteral("Colors:Window")).writeEntry("BackgroundNormal", QStringLiteral("10,20,30"));
+        QVERIFY(scheme.sync());
+    }
+    result = runBatch(batch, SchemeBatch::findSchemes(directories));
+    QCOMPARE(result.exported, 1);
+    QCOMPARE(result.unchanged, 2);
+    QFile otherTxt(output + QStringLiteral("/Other.txt"));
+    QVERIFY(otherTxt.open(QIODevice::ReadOnly));
+    QCOMPARE(otherTxt.readAll(), QByteArray("#0a141e\n"));
+
+    // deleted output
+    QVERIFY(QFile::remove(output + QStringLiteral("/System.txt")));
+    result = runBatch(batch, SchemeBatch::findSchemes(directories));
+    QCOMPARE(result.exported, 1);
+    QVERIFY(QFile::exists(output + QStringLiteral("/System.txt")));
+
+    // uninstalled scheme
+    QVERIFY(QFile::remove(directories[1] + QStringLiteral("/System.colors")));
+    result = runBatch(batch, SchemeBatch::findSchemes(directories));
+    QCOMPARE(result.removed, 1);
+    QCOMPARE(result.unchanged, 2);
+    QVERIFY(!QFile::exists(output + QStringLiteral("/System.css")));
+    QVERIFY(!QFile::exists(output + QStringLiteral("/System.txt")));
+
+    // a template that isn't exported anymore leaves no files behind
+    const SchemeExportSettings original = settings;
+    settings.templates.removeLast();
+    result = runBatch(batch, SchemeBatch::findSchemes(directories));
+    settings = original;
+    QCOMPARE(result.exported, 2);
+    QCOMPARE(result.removed, 0);
+    QVERIFY(QFile::exists(output + QStringLiteral("/Breeze.css")));
+    QVERIFY(QFile::exists(output + QStringLiteral("/Other.css")));
+    QVERIFY(!QFile::exists(output + QStringLiteral("/Breeze.txt")));
+    QVERIFY(!QFile::exists(output + QStringLiteral("/Other.txt")));
+}
+
+QTEST_GUILESS_MAIN(SchemeBatchTest)
+
+#include "schemeBatchTest.moc"
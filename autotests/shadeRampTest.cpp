@@ -0,0 +1,120 @@
+#include "shadeRamp.h"
+
+#include <QTest>
+
+#include <cmath>
+#include <vector>
+
+class ShadeRampTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testHslMatchesQColor_data();
+    void testHslMatchesQColor();
+    void testOklchEnds();
+    void testOklchMonotonic();
+    void testOklchKeepsBase();
+    void testLargeRamp();
+};
+
+void ShadeRampTest::testHslMatchesQColor_data()
+{
+    QTest::addColumn<QColor>("base");
+
+    QTest::newRow("breeze blue") << QColor(61, 174, 233);
+    QTest::newRow("red") << QColor(218, 68, 83);
+    QTest::newRow("green") << QColor(39, 174, 96);
+    QTest::newRow("purple") << QColor(155, 89, 182);
+    QTest::newRow("desaturated") << QColor(120, 126, 132);
+    QTest::newRow("gray") << QColor(128, 128, 128);
+    for (int hue = 0; hue < 360; hue += 15) {
+        QTest::addRow("hue %d", hue) << QColor::fromHsl(hue, 200, 128);
+    }
+}
+
+void ShadeRampTest::testHslMatchesQColor()
+{
+    QFETCH(QColor, base);
+
+    std::array<float, 256> lightness;
+    for (int l = 0; l < 256; l++) {
+        lightness[l] = l / 255.f;
+    }
+
+    std::array<QRgb, 256> shades;
+    ShadeRamp(ShadeRamp::Hsl, base).generate(lightness, shades);
+
+    for (int l = 0; l < 256; l++) {
+        const QRgb expected = QColor::fromHsl(base.hslHue(), base.hslSaturation(), l).rgb();
+        QVERIFY2(shades[l] == expected, qPrintable(QStringLiteral("lightness %1: %2 instead of %3").arg(l).arg(shades[l], 0, 16).arg(expected, 0, 16)));
+    }
+}
+
+void ShadeRampTest::testOklchEnds()
+{
+    const float lightness[] = {0.f, 1.f};
+    std::array<QRgb, 2> shades;
+    ShadeRamp(ShadeRamp::Oklch, QColor(218, 68, 83)).generate(lightness, shades);
+
+    QCOMPARE(shades[0], qRgb(0, 0, 0));
+    QCOMPARE(shades[1], qRgb(255, 255, 255));
+}
+
+void ShadeRampTest::testOklchMonotonic()
+{
+    std::array<float, 19> lightness;
+    for (std::size_t i = 0; i < lightness.size(); i++) {
+        lightness[i] = 0.95f - i * 0.05f;
+    }
+
+    for (const QColor &base : {QColor(61, 174, 233), QColor(246, 116, 0), QColor(39, 174, 96), QColor(35, 38, 41)}) {
+        std::array<QRgb, 19> shades;
+        ShadeRamp(ShadeRamp::Oklch, base).generate(lightness, shades);
+
+        for (std::size_t i = 1; i < shades.size(); i++) {
+            QVERIFY2(qGray(shades[i]) <= qGray(shades[i - 1]), qPrintable(base.name()));
+        }
+    }
+}
+
+void ShadeRampTest::testOklchKeepsBase()
+{
+    // at its own lightness the ramp gives back the base color
+    const QColor base(61, 174, 233);
+    const float r = base.redF() <= 0.04045f ? base.redF() / 12.92f : std::pow((base.redF() + 0.055f) / 1.055f, 2.4f);
+    const float g = base.greenF() <= 0.04045f ? base.greenF() / 12.92f : std::pow((base.greenF() + 0.055f) / 1.055f, 2.4f);
+    const float b = base.blueF() <= 0.04045f ? base.blueF() / 12.92f : std::pow((base.blueF() + 0.055f) / 1.055f, 2.4f);
+    const float l = std::cbrt(0.4122214708f * r + 0.5363325363f * g + 0.0514459929f * b);
+    const float m = std::cbrt(0.2119034982f * r + 0.6806995451f * g + 0.1073969566f * b);
+    const float s = std::cbrt(0.0883024619f * r + 0.2817188376f * g + 0.6299787005f * b);
+    const float lightness[] = {0.2104542553f * l + 0.7936177850f * m - 0.0040720468f * s};
+
+    std::array<QRgb, 1> shades;
+    ShadeRamp(ShadeRamp::Oklch, base).generate(lightness, shades);
+
+    QVERIFY(std::abs(qRed(shades[0]) - base.red()) <= 1);
+    QVERIFY(std::abs(qGreen(shades[0]) - base.green()) <= 1);
+    QVERIFY(std::abs(qBlue(shades[0]) - base.blue()) <= 1);
+}
+
+void ShadeRampTest::testLargeRamp()
+{
+    // more stops than fit in one block
+    std::vector<float> lightness(1000);
+    for (std::size_t i = 0; i < lightness.size(); i++) {
+        lightness[i] = 1.f - i / 999.f;
+    }
+
+    std::vector<QRgb> shades(lightness.size());
+    const QColor base(61, 174, 233);
+    ShadeRamp(ShadeRamp::Hsl, base).generate(lightness, shades);
+
+    for (std::size_t i = 0; i < shades.size(); i++) {
+        QCOMPARE(shades[i], QColor::fromHslF(base.hslHue() / 360.f, base.hslSaturation() / 255.f, lightness[i]).rgb());
+    }
+}
+
+QTEST_GUILESS_MAIN(ShadeRampTest)
+
+#include "shadeRampTest.moc"
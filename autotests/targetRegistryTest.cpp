@@ -0,0 +1,89 @@
+#include "targetRegistry.h"
+
+#include <QDir>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QTest>
+
+class TargetRegistryTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void init();
+    void testInitialState();
+    void testInstalledLater();
+    void testRemoved();
+
+private:
+    static QStringList names(const QList<ExportTarget> &targets);
+
+    QTemporaryDir dir;
+    QList<ExportTarget> targets;
+};
+
+void TargetRegistryTest::init()
+{
+    QVERIFY(dir.isValid());
+    QDir(dir.filePath(QStringLiteral("app"))).removeRecursively();
+    QVERIFY(QDir().mkpath(dir.filePath(QStringLiteral("installed"))));
+
+    auto css = std::make_shared<const OutputTemplate>(OutputTemplate::parse("{{#colors}}{{name}}\n{{/colors}}"));
+    targets = {
+        ExportTarget{QStringLiteral("always"), dir.filePath(QStringLiteral("always.css")), QString(), KdePalette, css},
+        ExportTarget{QStringLiteral("installed"), dir.filePath(QStringLiteral("installed/colors.css")), dir.filePath(QStringLiteral("installed")), KdePalette, css},
+        // two levels missing, like ~/.var/app/<id>/config/vesktop before the first flatpak install
+        ExportTarget{QStringLiteral("later"), dir.filePath(QStringLiteral("app/config/later/colors.css")), dir.filePath(QStringLiteral("app/config/later")), KdePalette, css},
+    };
+}
+
+QStringList TargetRegistryTest::names(const QList<ExportTarget> &targets)
+{
+    QStringList names;
+    for (const ExportTarget &target : targets) {
+        names.append(target.name);
+    }
+    return names;
+}
+
+void TargetRegistryTest::testInitialState()
+{
+    TargetRegistry registry;
+    registry.setTargets(targets);
+
+    QCOMPARE(registry.targets().size(), qsizetype(3));
+    QCOMPARE(names(registry.availableTargets()), (QStringList{QStringLiteral("always"), QStringLiteral("installed")}));
+    QVERIFY(registry.isAvailable(QStringLiteral("installed")));
+    QVERIFY(!registry.isAvailable(QStringLiteral("later")));
+    QVERIFY(!registry.isAvailable(QStringLiteral("unknown")));
+}
+
+void TargetRegistryTest::testInstalledLater()
+{
+    TargetRegistry registry;
+    registry.setTargets(targets);
+    QSignalSpy appeared(&registry, &TargetRegistry::targetsAppeared);
+
+    QVERIFY(QDir().mkpath(dir.filePath(QStringLiteral("app/config/later"))));
+
+    QTRY_COMPARE_WITH_TIMEOUT(appeared.count(), 1, 10000);
+    const QList<ExportTarget> appearedTargets = appeared.first().first().value<QList<ExportTarget>>();
+    QCOMPARE(names(appearedTargets), QStringList{QStringLiteral("later")});
+    QVERIFY(registry.isAvailable(QStringLiteral("later")));
+    QCOMPARE(registry.availableTargets().size(), qsizetype(3));
+}
+
+void TargetRegistryTest::testRemoved()
+{
+    TargetRegistry registry;
+    registry.setTargets(targets);
+
+    QVERIFY(QDir(dir.filePath(QStringLiteral("installed"))).removeRecursively());
+
+    QTRY_VERIFY_WITH_TIMEOUT(!registry.isAvailable(QStringLiteral("installed")), 10000);
+    QCOMPARE(names(registry.availableTargets()), QStringList{QStringLiteral("always")});
+}
+
+QTEST_GUILESS_MAIN(TargetRegistryTest)
+
+#include "targetRegistryTest.moc"
@@ -0,0 +1,133 @@
+#include "eventTrace.h"
+#include "kolorExporterDebug.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+using namespace Qt::Literals::StringLiterals;
+
+KConfigGroup ConfigChangeEvent::apply(KConfig &config, KConfig::WriteConfigFlags flags) const
+{
+    KConfigGroup configGroup = config.group(group.first());
+    for (qsizetype i = 1; i < group.size(); i++) {
+        configGroup = configGroup.group(group.at(i));
+    }
+
+    for (qsizetype i = 0; i < names.size(); i++) {
+        if (values.at(i).isNull()) {
+            configGroup.deleteEntry(names.at(i).constData(), flags);
+        } else {
+            configGroup.writeEntry(names.at(i).constData(), values.at(i), flags);
+        }
+    }
+    return configGroup;
+}
+
+std::optional<EventTrace> EventTrace::load(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qCWarning(KOLOR_EXPORTER) << "Can't read" << fileName << file.errorString();
+        return std::nullopt;
+    }
+
+    EventTrace trace;
+    bool started = false;
+    int lineNumber = 0;
+    while (!file.atEnd()) {
+        lineNumber++;
+        const QByteArray line = file.readLine().trimmed();
+        if (line.isEmpty()) {
+            continue;
+        }
+
+        const QJsonObject record = QJsonDocument::fromJson(line).object();
+        const QString type = record["type"_L1].toString();
+        if (type == "start"_L1 && !started) {
+            trace.kdeglobals = record["kdeglobals"_L1].toString().toUtf8();
+            started = true;
+            continue;
+        }
+
+        ConfigChangeEvent event;
+        event.time = record["time"_L1].toInteger(-1);
+        const QJsonArray group = record["group"_L1].toArray();
+        for (const QJsonValue &name : group) {
+            event.group.append(name.toString());
+        }
+        const QJsonObject entries = record["entries"_L1].toObject();
+        for (auto it = entries.constBegin(); it != entries.constEnd(); ++it) {
+            event.names.append(it.key().toUtf8());
+            event.values.append(it->isNull() ? QString() : it->toString());
+        }
+
+        // a change before the start record would be applied to the wrong kdeglobals
+        if (type != "change"_L1 || !started || event.time < 0 || event.group.isEmpty() || event.group.contains(QString())) {
+            qCWarning(KOLOR_EXPORTER) << "Invalid event at" << fileName << "line" << lineNumber;
+            return std::nullopt;
+        }
+        trace.events.append(std::move(event));
+    }
+
+    if (!started) {
+        qCWarning(KOLOR_EXPORTER) << fileName << "has no start record";
+        return std::nullopt;
+    }
+    return trace;
+}
+
+bool EventRecorder::open(const QString &fileName, const QString &kdeglobalsFileName)
+{
+    file.close();
+    file.setFileName(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qCWarning(KOLOR_EXPORTER) << "Can't record events to" << fileName << file.errorString();
+        return false;
+    }
+
+    // a missing kdeglobals is a valid start too, everything is at its default
+    QFile kdeglobals(kdeglobalsFileName);
+    QByteArray contents;
+    if (kdeglobals.open(QIODevice::ReadOnly)) {
+        contents = kdeglobals.readAll();
+    }
+
+    timer.start();
+    writeLine(QJsonObject{{u"type"_s, u"start"_s}, {u"kdeglobals"_s, QString::fromUtf8(contents)}});
+    return true;
+}
+
+QString EventRecorder::fileName() const
+{
+    return file.fileName();
+}
+
+void EventRecorder::record(const KConfigGroup &group, const QByteArrayList &names)
+{
+    QStringList path;
+    for (KConfigGroup parent = group; parent.name() != QStringLiteral("<default>"); parent = parent.parent()) {
+        path.prepend(parent.name());
+    }
+
+    QJsonObject entries;
+    for (const QByteArray &name : names) {
+        entries.insert(QString::fromUtf8(name), group.hasKey(name.constData()) ? QJsonValue(group.readEntry(name.constData(), QString())) : QJsonValue());
+    }
+
+    writeLine(QJsonObject{
+        {u"type"_s, u"change"_s},
+        {u"time"_s, timer.elapsed()},
+        {u"group"_s, QJsonArray::fromStringList(path)},
+        {u"entries"_s, entries},
+    });
+}
+
+void EventRecorder::writeLine(const QJsonObject &object)
+{
+    QByteArray line = QJsonDocument(object).toJson(QJsonDocument::Compact);
+    line.append('\n');
+    if (file.write(line) != line.size() || !file.flush()) {
+        qCWarning(KOLOR_EXPORTER) << "Can't write to" << file.fileName() << file.errorString();
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <QByteArray>
+#include <QByteArrayList>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+#include <KConfigGroup>
+
+#include <optional>
+
+class QJsonObject;
+
+// One kdeglobals change like KConfigWatcher reported it, with the values the
+// keys had afterwards so it can be applied again.
+struct ConfigChangeEvent {
+    // milliseconds since the recording started
+    qint64 time = 0;
+    // from the top level group down, e.g. {"Colors:Header", "Inactive"}
+    QStringList group;
+    QByteArrayList names;
+    // same order as names, a null string for a key that was deleted
+    QStringList values;
+
+    // writes the values to config, returns the group to pass to onKdeglobalsSettingsChange().
+    // KConfig::Global to write to kdeglobals through a config that includes it
+    KConfigGroup apply(KConfig &config, KConfig::WriteConfigFlags flags = KConfig::Normal) const;
+};
+
+// What EventRecorder wrote, for replaying a session.
+struct EventTrace {
+    // the whole file when the recording started
+    QByteArray kdeglobals;
+    QList<ConfigChangeEvent> events;
+
+    // nullopt if the file can't be read or a line isn't an event
+    static std::optional<EventTrace> load(const QString &fileName);
+};
+
+// Writes every kdeglobals change the module sees to a file, to replay a real
+// session later, see autotests/replaySoakTest.cpp. One line of JSON per record:
+//   {"type":"start","kdeglobals":"<the whole file>"}
+// once, and then for every change
+//   {"type":"change","time":1234,"group":["Colors:View"],"entries":{"BackgroundNormal":"252,252,252","Removed":null}}
+// Every line is flushed right away, so the trace survives kded being killed.
+class EventRecorder
+{
+public:
+    // replaces fileName, false if it can't be written
+    bool open(const QString &fileName, const QString &kdeglobalsFileName);
+    QString fileName() const;
+
+    void record(const KConfigGroup &group, const QByteArrayList &names);
+
+private:
+    void writeLine(const QJsonObject &object);
+
+    QFile file;
+    QElapsedTimer timer;
+};
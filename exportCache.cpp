@@ -0,0 +1,170 @@
+#include "exportCache.h"
+#include "kolorExporterDebug.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+
+#include <KConfigGroup>
+
+#include <kcolorscheme_version.h>
+
+#include <algorithm>
+
+namespace
+{
+// bump when the same inputs start producing different files
+constexpr QByteArrayView cacheVersion = "1";
+
+void addField(QCryptographicHash &hash, QByteArrayView data)
+{
+    hash.addData(data);
+    // separator, so "ab" + "c" and "a" + "bc" hash differently
+    hash.addData(QByteArrayView("\0", 1));
+}
+
+void addString(QCryptographicHash &hash, const QString &data)
+{
+    addField(hash, data.toUtf8());
+}
+
+// entries and nested groups, like [Colors:Header][Inactive], in a stable order
+void addGroup(QCryptographicHash &hash, const KConfigGroup &group)
+{
+    addString(hash, group.name());
+
+    const QMap<QString, QString> entries = group.entryMap();
+    for (auto it = entries.cbegin(); it != entries.cend(); ++it) {
+        addString(hash, it.key());
+        addString(hash, it.value());
+    }
+
+    QStringList groups = group.groupList();
+    std::sort(groups.begin(), groups.end());
+    for (const QString &name : std::as_const(groups)) {
+        addGroup(hash, group.group(name));
+    }
+}
+}
+
+ExportCache::ExportCache()
+    : ExportCache(QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + QStringLiteral("/kolor-exporter/exportcache"))
+{
+}
+
+ExportCache::ExportCache(const QString &fileName)
+    : config(KSharedConfig::openConfig(fileName, KConfig::SimpleConfig))
+{
+}
+
+QByteArray ExportCache::inputsHash(const KSharedConfigPtr &kdeglobals, const RampSettings &ramps, const QList<ExportTarget> &targets)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    addField(hash, cacheVersion);
+    // KColorScheme decides what the effects and fallbacks do with these
+    addField(hash, QByteArrayView(KCOLORSCHEME_VERSION_STRING));
+
+    // the same groups onKdeglobalsSettingsChange() reacts to
+    const KConfigGroup general = kdeglobals->group(QStringLiteral("General"));
+    addString(hash, general.readEntry("ColorScheme", QString()));
+    addString(hash, general.readEntry("AccentColor", QString()));
+    for (const char *key : {"TintFactor", "accentColorFromWallpaper", "accentActiveTitlebar", "accentInactiveTitlebar"}) {
+        addString(hash, general.readEntry(key, QString()));
+    }
+
+    QStringList groups = kdeglobals->groupList();
+    std::sort(groups.begin(), groups.end());
+    for (const QString &name : std::as_const(groups)) {
+        if (name.startsWith(QStringLiteral("Colors:")) || name.startsWith(QStringLiteral("ColorEffects:")) || name == QStringLiteral("WM")) {
+            addGroup(hash, kdeglobals->group(name));
+        }
+    }
+
+    addField(hash, QByteArray::number(ramps.roles));
+    addField(hash, QByteArray::number(ramps.space));
+    addField(hash, QByteArray::number(ramps.stopCount));
+    for (qsizetype i = 0; i < ramps.stopCount; i++) {
+        addField(hash, QByteArray::number(ramps.stops[i]));
+    }
+
+    for (const ExportTarget &target : targets) {
+        addString(hash, target.name);
+        addString(hash, target.path);
+        addString(hash, target.requiredDirectory);
+        addField(hash, QByteArray::number(target.palette));
+        addField(hash, target.outputTemplate->checksum());
+        addField(hash, target.link ? "link" : "file");
+    }
+
+    return hash.result();
+}
+
+bool ExportCache::isUpToDate(const QByteArray &inputs) const
+{
+    if (config->group(QStringLiteral("General")).readEntry("Inputs", QByteArray()) != inputs.toHex()) {
+        return false;
+    }
+
+    const QStringList paths = config->group(QStringLiteral("Outputs")).keyList();
+    return std::all_of(paths.cbegin(), paths.cend(), [](const QString &path) {
+        return QFileInfo::exists(path);
+    });
+}
+
+bool ExportCache::verifyOutputs(const QList<ExportTarget> &targets) const
+{
+    const KConfigGroup outputs = config->group(QStringLiteral("Outputs"));
+
+    for (const ExportTarget &target : targets) {
+        const QByteArray checksum = QByteArray::fromHex(outputs.readEntry(target.path, QByteArray()));
+        if (checksum.isEmpty()) {
+            // not exported last time, fine as long as the app still isn't installed
+            if (target.requiredDirectory.isEmpty() || QFileInfo(target.requiredDirectory).isDir()) {
+                qCDebug(KOLOR_EXPORTER) << "No cached export for" << target.path;
+                return false;
+            }
+            continue;
+        }
+
+        QFile file(target.path);
+        if (!file.open(QIODevice::ReadOnly) || QCryptographicHash::hash(file.readAll(), QCryptographicHash::Sha1) != checksum) {
+            qCDebug(KOLOR_EXPORTER) << target.path << "changed since it was exported";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void ExportCache::store(const QByteArray &inputs, const QList<ExportTargetResult> &results)
+{
+    config->group(QStringLiteral("Outputs")).deleteGroup();
+    config->group(QStringLiteral("General")).writeEntry("Inputs", inputs.toHex());
+    writeOutputs(results);
+}
+
+void ExportCache::update(const QList<ExportTargetResult> &results)
+{
+    writeOutputs(results);
+}
+
+void ExportCache::update(const QByteArray &inputs, const QList<ExportTargetResult> &results)
+{
+    config->group(QStringLiteral("General")).writeEntry("Inputs", inputs.toHex());
+    writeOutputs(results);
+}
+
+void ExportCache::writeOutputs(const QList<ExportTargetResult> &results)
+{
+    KConfigGroup outputs = config->group(QStringLiteral("Outputs"));
+    for (const ExportTargetResult &result : results) {
+        outputs.writeEntry(result.path, result.checksum.toHex());
+    }
+
+    QDir().mkpath(QFileInfo(config->name()).absolutePath());
+    if (!config->sync()) {
+        qCWarning(KOLOR_EXPORTER) << "Failed to write the export cache" << config->name();
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "exportJob.h"
+#include "exportTarget.h"
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+#include <KSharedConfig>
+
+// Remembers what the last export was made from and what it wrote, so the
+// module can skip the export at login when nothing changed since the last session.
+// Stored in ~/.cache/kolor-exporter/exportcache.
+class ExportCache
+{
+public:
+    ExportCache();
+    explicit ExportCache(const QString &fileName);
+
+    // hash of everything the exported files depend on: the color groups of kdeglobals,
+    // the accent color, the ramp settings, the targets and their templates
+    static QByteArray inputsHash(const KSharedConfigPtr &kdeglobals, const RampSettings &ramps, const QList<ExportTarget> &targets);
+
+    // the last export was made from these inputs and its files are still there.
+    // only stats the files, meant for startup
+    bool isUpToDate(const QByteArray &inputs) const;
+    // reads the files back and compares them with what was written, also false if a
+    // target that wasn't exported last time can be now
+    bool verifyOutputs(const QList<ExportTarget> &targets) const;
+
+    void store(const QByteArray &inputs, const QList<ExportTargetResult> &results);
+    // adds the files of an export to only some targets, made from the same inputs as the last store()
+    void update(const QList<ExportTargetResult> &results);
+    // an export that only wrote the targets using a color that changed, the files of
+    // the others are what these inputs make too
+    void update(const QByteArray &inputs, const QList<ExportTargetResult> &results);
+
+private:
+    void writeOutputs(const QList<ExportTargetResult> &results);
+
+    KSharedConfigPtr config;
+};
@@ -0,0 +1,189 @@
+#include "exportJob.h"
+#include "kolorExporterDebug.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+ExportJob::ExportJob(ExportSnapshot snapshot, std::shared_ptr<const std::atomic<quint64>> latestGeneration, Callback callback)
+    : snapshot(std::move(snapshot))
+    , latestGeneration(std::move(latestGeneration))
+    , callback(std::move(callback))
+{
+}
+
+bool ExportJob::hasSameContent(const ExportTarget &a, const ExportTarget &b)
+{
+    // templates are shared between targets using the same one, see loadExportTargets()
+    return a.outputTemplate == b.outputTemplate && a.palette == b.palette;
+}
+
+QString ExportJob::existingCanonicalPath(const ExportTarget &target) const
+{
+    for (const ExportTarget &other : snapshot.allTargets) {
+        if (!other.link && hasSameContent(target, other) && QFileInfo::exists(other.path)) {
+            return other.path;
+        }
+    }
+    return QString();
+}
+
+bool ExportJob::isSuperseded() const
+{
+    return latestGeneration->load(std::memory_order_relaxed) != snapshot.generation;
+}
+
+void ExportJob::run()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    ExportResult result;
+    result.generation = snapshot.generation;
+
+    // reused for every group so it's only allocated once
+    QByteArray content;
+    const QList<ExportTarget> &targets = snapshot.targets;
+    QList<bool> exported(targets.size(), false);
+
+    // targets with the same template and palette get the same content (e.g. all the
+    // vencord and vesktop installs), so it's rendered once per group and written to each
+    for (qsizetype first = 0; first < targets.size() && !result.cancelled; first++) {
+        if (exported.at(first)) {
+            continue;
+        }
+
+        const ExportTarget &groupTarget = targets.at(first);
+        content.resize(0);
+        groupTarget.outputTemplate->render(snapshot.palettes[groupTarget.palette], content);
+        const QByteArray checksum = QCryptographicHash::hash(content, QCryptographicHash::Sha1);
+
+        // the file the targets with Link=true point to, the first one of the group that isn't a link
+        QString canonicalPath;
+        bool hasLinks = false;
+        for (qsizetype i = first; i < targets.size(); i++) {
+            if (!hasSameContent(groupTarget, targets.at(i))) {
+                continue;
+            }
+            if (!targets.at(i).link) {
+                canonicalPath = targets.at(i).path;
+                break;
+            }
+            hasLinks = true;
+        }
+        // e.g. the app of a link was just installed, its file was written by an earlier
+        // export with the same colors, or the links are copies if it never was
+        if (canonicalPath.isEmpty() && hasLinks) {
+            canonicalPath = existingCanonicalPath(groupTarget);
+        }
+
+        // the files first and the links to them after, so a job cancelled in between
+        // never leaves a link pointing at a file that wasn't written yet
+        for (const bool links : {false, true}) {
+            for (qsizetype i = first; i < targets.size() && !result.cancelled; i++) {
+                const ExportTarget &target = targets.at(i);
+                if (exported.at(i) || target.link != links || !hasSameContent(groupTarget, target)) {
+                    continue;
+                }
+
+                // checked before every target, the newer job will rewrite everything anyway
+                if (isSuperseded()) {
+                    result.cancelled = true;
+                    break;
+                }
+                exported[i] = true;
+
+                ExportTargetResult::Status status;
+                if (target.link && !canonicalPath.isEmpty()) {
+                    status = linkFile(target.path, canonicalPath);
+                } else {
+                    status = writeFileIfChanged(target.path, content);
+                    if (status == ExportTargetResult::Written) {
+                        result.bytesWritten += content.size();
+                    }
+                    // the links get copies instead of pointing at a file that may be stale or missing
+                    if (status == ExportTargetResult::Failed && target.path == canonicalPath) {
+                        canonicalPath.clear();
+                    }
+                }
+
+                result.targets.append(
+                    ExportTargetResult{target.name, target.path, status, status != ExportTargetResult::Failed ? checksum : QByteArray()});
+            }
+        }
+    }
+
+    result.elapsedNanoseconds = timer.nsecsElapsed();
+    callback(result);
+}
+
+bool ExportJob::makeParentDirectory(const QString &path)
+{
+    const QString directory = QFileInfo(path).absolutePath();
+    if (!QDir().mkpath(directory)) {
+        qCWarning(KOLOR_EXPORTER) << "Failed to create" << directory;
+        return false;
+    }
+    return true;
+}
+
+ExportTargetResult::Status ExportJob::writeFileIfChanged(const QString &path, const QByteArray &content)
+{
+    // unchanged files are left alone so apps watching them don't reload for nothing
+    QFile existing(path);
+    if (existing.size() == content.size() && existing.open(QIODevice::ReadOnly) && existing.readAll() == content) {
+        return ExportTargetResult::Skipped;
+    }
+
+    // the app is installed (see RequiredDirectory), but it may not have made the
+    // directory the file goes in yet, e.g. Vencord only creates themes/ later
+    if (!makeParentDirectory(path)) {
+        return ExportTargetResult::Failed;
+    }
+
+    // QSaveFile writes to a temporary file and renames it over the target on commit,
+    // so readers never see a half written file
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(content) != content.size() || !file.commit()) {
+        qCWarning(KOLOR_EXPORTER) << "Failed to write" << path << file.errorString();
+        return ExportTargetResult::Failed;
+    }
+
+    return ExportTargetResult::Written;
+}
+
+ExportTargetResult::Status ExportJob::linkFile(const QString &path, const QString &target)
+{
+    const QFileInfo info(path);
+    if (info.isSymLink() && info.symLinkTarget() == QFileInfo(target).absoluteFilePath()) {
+        return ExportTargetResult::Skipped;
+    }
+
+    if (!makeParentDirectory(path)) {
+        return ExportTargetResult::Failed;
+    }
+
+    // made next to the target and renamed over it, so like with QSaveFile there's
+    // never a moment where the file is missing
+    const QString temporaryPath = path + QStringLiteral(".kolor-exporter-link");
+    QFile::remove(temporaryPath);
+    if (!QFile::link(target, temporaryPath)) {
+        qCWarning(KOLOR_EXPORTER) << "Failed to link" << path << "to" << target;
+        return ExportTargetResult::Failed;
+    }
+
+    if (std::rename(QFile::encodeName(temporaryPath).constData(), QFile::encodeName(path).constData()) != 0) {
+        qCWarning(KOLOR_EXPORTER) << "Failed to replace" << path << "with a link to" << target << strerror(errno);
+        QFile::remove(temporaryPath);
+        return ExportTargetResult::Failed;
+    }
+
+    return ExportTargetResult::Written;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "exportTarget.h"
+#include "palette.h"
+
+#include <QList>
+#include <QRunnable>
+#include <QString>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+// Everything an export needs, captured on the GUI thread since the colors come from
+// the shared kdeglobals KSharedConfig, which KConfigWatcher reparses there and
+// which isn't thread safe. The job itself only does rendering and file I/O.
+struct ExportSnapshot {
+    quint64 generation = 0;
+    std::array<Palette, PaletteCount> palettes;
+    // only installed targets, see TargetRegistry
+    QList<ExportTarget> targets;
+    // every enabled target, installed or not. A link whose canonical target isn't
+    // exported this time points at its file if it's there
+    QList<ExportTarget> allTargets;
+};
+
+struct ExportTargetResult {
+    enum Status {
+        Written,
+        Skipped,
+        Failed,
+    };
+
+    QString name;
+    QString path;
+    Status status;
+    // sha1 of the file content, empty if it failed
+    QByteArray checksum;
+};
+
+struct ExportResult {
+    quint64 generation = 0;
+    // a newer export was requested while this one was queued or running
+    bool cancelled = false;
+    QList<ExportTargetResult> targets;
+    // time spent rendering and writing, and how much of it actually hit the disk
+    qint64 elapsedNanoseconds = 0;
+    qint64 bytesWritten = 0;
+};
+
+class ExportJob : public QRunnable
+{
+public:
+    using Callback = std::function<void(const ExportResult &)>;
+
+    ExportJob(ExportSnapshot snapshot, std::shared_ptr<const std::atomic<quint64>> latestGeneration, Callback callback);
+
+    void run() override;
+
+    // returns Skipped if the file already has exactly this content. Creates the
+    // directory it goes in, so only call it for targets that are available
+    static ExportTargetResult::Status writeFileIfChanged(const QString &path, const QByteArray &content);
+    // replaces path with a symlink to target, Skipped if it already is one
+    static ExportTargetResult::Status linkFile(const QString &path, const QString &target);
+
+private:
+    static bool makeParentDirectory(const QString &path);
+    static bool hasSameContent(const ExportTarget &a, const ExportTarget &b);
+    // the file of a target in snapshot.allTargets the links of target's group can point to
+    QString existingCanonicalPath(const ExportTarget &target) const;
+    bool isSuperseded() const;
+
+    ExportSnapshot snapshot;
+    std::shared_ptr<const std::atomic<quint64>> latestGeneration;
+    Callback callback;
+};
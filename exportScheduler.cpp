@@ -0,0 +1,52 @@
+#include "exportScheduler.h"
+#include "kolorExporterDebug.h"
+
+ExportScheduler::ExportScheduler(QObject *parent)
+    : QObject(parent)
+{
+    timer.setSingleShot(true);
+    timer.setTimerType(Qt::PreciseTimer);
+
+    connect(&timer, &QTimer::timeout, this, [this]() {
+        qCDebug(KOLOR_EXPORTER) << "Running export for" << mergedRequests << "merged requests";
+        mergedRequests = 0;
+        Q_EMIT exportRequested();
+    });
+}
+
+void ExportScheduler::setInterval(int msec)
+{
+    timer.setInterval(qMax(0, msec));
+}
+
+int ExportScheduler::interval() const
+{
+    return timer.interval();
+}
+
+bool ExportScheduler::isPending() const
+{
+    return timer.isActive();
+}
+
+void ExportScheduler::schedule()
+{
+    mergedRequests++;
+
+    // don't restart the timer, otherwise a continuous stream of changes would
+    // keep pushing the export back and the output would stay stale
+    if (!timer.isActive()) {
+        timer.start();
+    }
+}
+
+void ExportScheduler::flush()
+{
+    if (!timer.isActive()) {
+        return;
+    }
+
+    timer.stop();
+    mergedRequests = 0;
+    Q_EMIT exportRequested();
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <QObject>
+#include <QTimer>
+
+// Merges bursts of export requests (e.g. dragging the accent color picker).
+// The first request opens a window, any request arriving inside it is folded
+// into the same export, and that export always runs once the window closes.
+class ExportScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ExportScheduler(QObject *parent = nullptr);
+
+    void setInterval(int msec);
+    int interval() const;
+
+    bool isPending() const;
+
+public Q_SLOTS:
+    // queue an export, runs at most interval() ms from now
+    void schedule();
+    // run a pending export right away instead of waiting for the window to close
+    void flush();
+
+Q_SIGNALS:
+    void exportRequested();
+
+private:
+    QTimer timer;
+    // how many requests were merged into the pending export, only for debugging
+    int mergedRequests = 0;
+};
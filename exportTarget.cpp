@@ -0,0 +1,253 @@
+#include "exportTarget.h"
+#include "kolorExporterDebug.h"
+
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QStandardPaths>
+
+#include <KConfigGroup>
+
+#include <algorithm>
+#include <optional>
+
+namespace
+{
+struct TargetSettings {
+    QString name;
+    QString path;
+    QString templateName;
+    QString paletteName;
+    QString requiredDirectory;
+    bool enabled = true;
+    bool link = false;
+};
+
+QList<TargetSettings> defaultTargets()
+{
+    const QString cfgDir = QStandardPaths::writableLocation(QStandardPaths::GenericConfigLocation);
+    const QString dataDir = QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation);
+    const QString homeDir = QStandardPaths::writableLocation(QStandardPaths::HomeLocation);
+
+    auto vencord = [](const QString &name, const QString &configDir) {
+        return TargetSettings{name, configDir + QStringLiteral("/themes/kde-colors.css"), QStringLiteral("vencord"), QStringLiteral("discord"), configDir};
+    };
+
+    return {
+        {QStringLiteral("kde-colors"), cfgDir + QStringLiteral("/kde-colors.css"), QStringLiteral("css"), QStringLiteral("kde")},
+        // rofi doesn't make ~/.local/share/rofi itself, whoever has it uses its themes
+        {QStringLiteral("rofi"),
+         dataDir + QStringLiteral("/rofi/themes/kde-colors.rasi"),
+         QStringLiteral("rasi"),
+         QStringLiteral("kde"),
+         dataDir + QStringLiteral("/rofi")},
+        // vencord installed on vanilla discord
+        vencord(QStringLiteral("vencord"), cfgDir + QStringLiteral("/Vencord")),
+        vencord(QStringLiteral("vencord-flatpak"), homeDir + QStringLiteral("/.var/app/com.discordapp.Discord/config/Vencord")),
+        // vesktop
+        vencord(QStringLiteral("vesktop"), cfgDir + QStringLiteral("/vesktop")),
+        vencord(QStringLiteral("vesktop-flatpak"), homeDir + QStringLiteral("/.var/app/dev.vencord.Vesktop/config/vesktop")),
+    };
+}
+
+// a color the palette doesn't have would silently render as nothing
+void warnAboutUnknownColors(const char *kind, const QString &name, const OutputTemplate &outputTemplate, PaletteId palette, const RampSettings &ramps)
+{
+    const QByteArrayList colors = outputTemplate.namedColors();
+    for (const QByteArray &color : colors) {
+        if (!paletteHasColor(palette, QLatin1StringView(color), ramps)) {
+            qCWarning(KOLOR_EXPORTER) << kind << name << "uses" << color << "which isn't in its palette, it will be empty";
+        }
+    }
+}
+}
+
+QString expandHome(const QString &path)
+{
+    if (path.startsWith(QStringLiteral("~/"))) {
+        return QDir::homePath() + path.mid(1);
+    }
+    return path;
+}
+
+std::optional<PaletteId> paletteFromName(const QString &name)
+{
+    if (name == QStringLiteral("kde")) {
+        return KdePalette;
+    } else if (name == QStringLiteral("discord")) {
+        return DiscordPalette;
+    } else if (name == QStringLiteral("ramps")) {
+        return RampPalette;
+    }
+    return std::nullopt;
+}
+
+std::shared_ptr<const OutputTemplate> loadTemplate(const QString &name, QHash<QString, std::shared_ptr<const OutputTemplate>> &cache)
+{
+    if (auto it = cache.constFind(name); it != cache.constEnd()) {
+        return it.value();
+    }
+
+    QString fileName = expandHome(name);
+    if (!QDir::isAbsolutePath(fileName)) {
+        fileName = QStandardPaths::locate(QStandardPaths::GenericDataLocation, QStringLiteral("kolor-exporter/templates/%1.tmpl").arg(name));
+        if (fileName.isEmpty()) {
+            fileName = QStringLiteral(":/kolor-exporter/templates/%1.tmpl").arg(name);
+        }
+    }
+
+    std::shared_ptr<OutputTemplate> outputTemplate;
+    QFile file(fileName);
+    if (file.open(QIODevice::ReadOnly)) {
+        outputTemplate = std::make_shared<OutputTemplate>(OutputTemplate::parse(file.readAll()));
+        if (!outputTemplate->isValid()) {
+            qCWarning(KOLOR_EXPORTER) << "Invalid template" << fileName << outputTemplate->errorString();
+            outputTemplate.reset();
+        }
+    } else {
+        qCWarning(KOLOR_EXPORTER) << "Can't open template" << fileName << file.errorString();
+    }
+
+    cache.insert(name, outputTemplate);
+    return outputTemplate;
+}
+
+QList<ExportTarget> loadExportTargets(const KSharedConfigPtr &config)
+{
+    QList<TargetSettings> settings = defaultTargets();
+
+    const KConfigGroup targetsConfig = config->group(QStringLiteral("Targets"));
+    const QStringList groupNames = targetsConfig.groupList();
+    for (const QString &name : groupNames) {
+        const KConfigGroup group = targetsConfig.group(name);
+
+        auto it = std::find_if(settings.begin(), settings.end(), [&name](const TargetSettings &target) {
+            return target.name == name;
+        });
+        if (it == settings.end()) {
+            it = settings.insert(settings.end(), TargetSettings{name});
+        }
+
+        it->path = expandHome(group.readPathEntry("Path", it->path));
+        it->templateName = group.readEntry("Template", it->templateName);
+        it->paletteName = group.readEntry("Palette", it->paletteName.isEmpty() ? QStringLiteral("kde") : it->paletteName);
+        it->requiredDirectory = expandHome(group.readPathEntry("RequiredDirectory", it->requiredDirectory));
+        it->enabled = group.readEntry("Enabled", it->enabled);
+        it->link = group.readEntry("Link", it->link);
+    }
+
+    const RampSettings ramps = loadRampSettings(config);
+    QList<ExportTarget> targets;
+    QHash<QString, std::shared_ptr<const OutputTemplate>> templates;
+    for (const TargetSettings &target : std::as_const(settings)) {
+        if (!target.enabled) {
+            continue;
+        }
+
+        if (target.path.isEmpty() || target.templateName.isEmpty()) {
+            qCWarning(KOLOR_EXPORTER) << "Target" << target.name << "needs both a Path and a Template";
+            continue;
+        }
+
+        const std::optional<PaletteId> palette = paletteFromName(target.paletteName);
+        if (!palette) {
+            qCWarning(KOLOR_EXPORTER) << "Target" << target.name << "uses unknown palette" << target.paletteName;
+            continue;
+        }
+
+        std::shared_ptr<const OutputTemplate> outputTemplate = loadTemplate(target.templateName, templates);
+        if (!outputTemplate) {
+            continue;
+        }
+        warnAboutUnknownColors("Target", target.name, *outputTemplate, *palette, ramps);
+
+        targets.append(ExportTarget{target.name, target.path, target.requiredDirectory, *palette, std::move(outputTemplate), target.link});
+    }
+
+    return targets;
+}
+
+SchemeExportSettings loadSchemeExportSettings(const KSharedConfigPtr &config)
+{
+    const KConfigGroup group = config->group(QStringLiteral("Schemes"));
+
+    SchemeExportSettings settings;
+    settings.directory = expandHome(group.readPathEntry(
+        "Directory",
+        QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation) + QStringLiteral("/kolor-exporter/schemes")));
+
+    const QString paletteName = group.readEntry("Palette", QStringLiteral("kde"));
+    const std::optional<PaletteId> palette = paletteFromName(paletteName);
+    if (!palette) {
+        qCWarning(KOLOR_EXPORTER) << "Scheme export uses unknown palette" << paletteName;
+        return settings;
+    }
+    settings.palette = *palette;
+    settings.ramps = loadRampSettings(config);
+
+    QHash<QString, std::shared_ptr<const OutputTemplate>> templates;
+    const QStringList templateNames = group.readEntry("Templates", QStringList());
+    for (const QString &name : templateNames) {
+        // the name ends up in the file names, so only the built in style of names
+        if (name.isEmpty() || name.contains(QLatin1Char('/'))) {
+            qCWarning(KOLOR_EXPORTER) << "Scheme export can't use template" << name << ", only template names are supported";
+            continue;
+        }
+        if (std::shared_ptr<const OutputTemplate> outputTemplate = loadTemplate(name, templates)) {
+            warnAboutUnknownColors("Scheme template", name, *outputTemplate, *palette, settings.ramps);
+            settings.templates.append(std::pair(name, std::move(outputTemplate)));
+        }
+    }
+
+    return settings;
+}
+
+RampSettings loadRampSettings(const KSharedConfigPtr &config)
+{
+    const KConfigGroup group = config->group(QStringLiteral("Ramps"));
+    RampSettings settings;
+
+    if (group.hasKey("Roles")) {
+        settings.roles = 0;
+        const QStringList names = group.readEntry("Roles", QStringList());
+        for (const QString &name : names) {
+            int role = 0;
+            while (role < RampSettings::RoleCount && rampRoleName(role) != name) {
+                role++;
+            }
+            if (role == RampSettings::RoleCount) {
+                qCWarning(KOLOR_EXPORTER) << "Unknown ramp role" << name;
+                continue;
+            }
+            settings.roles |= quint32(1) << role;
+        }
+    }
+
+    if (group.hasKey("Stops")) {
+        // sorted and without duplicates, whatever order they're listed in
+        std::array<bool, RampSettings::MaxStops> picked = {};
+        const QList<int> stops = group.readEntry("Stops", QList<int>());
+        for (int stop : stops) {
+            if (stop % RampSettings::StopStep != 0 || stop < RampSettings::StopStep || stop > RampSettings::StopStep * RampSettings::MaxStops) {
+                qCWarning(KOLOR_EXPORTER) << "Ramp stop" << stop << "isn't one of 50, 100, 150 ... 950";
+                continue;
+            }
+            picked[stop / RampSettings::StopStep - 1] = true;
+        }
+        settings.stopCount = 0;
+        for (qsizetype i = 0; i < RampSettings::MaxStops; i++) {
+            if (picked[i]) {
+                settings.stops[settings.stopCount++] = int(i + 1) * RampSettings::StopStep;
+            }
+        }
+    }
+
+    const QString space = group.readEntry("Space", QStringLiteral("oklch"));
+    if (space == QStringLiteral("hsl")) {
+        settings.space = ShadeRamp::Hsl;
+    } else if (space != QStringLiteral("oklch")) {
+        qCWarning(KOLOR_EXPORTER) << "Unknown ramp space" << space << ", using oklch";
+    }
+
+    return settings;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "outputTemplate.h"
+#include "palette.h"
+
+#include <QHash>
+#include <QList>
+#include <QString>
+
+#include <KSharedConfig>
+
+#include <memory>
+#include <optional>
+#include <utility>
+
+struct ExportTarget {
+    QString name;
+    QString path;
+    // only exported while this directory exists, for apps that might not be installed
+    QString requiredDirectory;
+    PaletteId palette = KdePalette;
+    std::shared_ptr<const OutputTemplate> outputTemplate;
+    // a symlink to another target with the same template and palette instead of a copy
+    bool link = false;
+};
+
+// ~/ at the start replaced with the home directory, like in the Path keys
+QString expandHome(const QString &path);
+
+// "kde", "discord" or "ramps", like the Palette key
+std::optional<PaletteId> paletteFromName(const QString &name);
+
+// A template by name or path, like the Template key. Templates in
+// ~/.local/share/kolor-exporter/templates override the built in ones. nullptr
+// if it can't be read or doesn't parse, cache holds every name looked up so far.
+std::shared_ptr<const OutputTemplate> loadTemplate(const QString &name, QHash<QString, std::shared_ptr<const OutputTemplate>> &cache);
+
+// The built in targets with the [Targets][<name>] groups of config applied on top.
+// Templates are parsed here, once, and shared between targets using the same one.
+QList<ExportTarget> loadExportTargets(const KSharedConfigPtr &config);
+
+// The [Schemes] group of config: every installed color scheme is exported with
+// each template to <directory>/<scheme>.<template name>.
+struct SchemeExportSettings {
+    QString directory;
+    PaletteId palette = KdePalette;
+    RampSettings ramps;
+    QList<std::pair<QString, std::shared_ptr<const OutputTemplate>>> templates;
+
+    // no templates means it's disabled, the default
+    bool isEnabled() const
+    {
+        return !templates.isEmpty();
+    }
+};
+
+SchemeExportSettings loadSchemeExportSettings(const KSharedConfigPtr &config);
+
+// The [Ramps] group of config, which roles and stops the ramps palette has
+RampSettings loadRampSettings(const KSharedConfigPtr &config);
@@ -0,0 +1,216 @@
+#include "exportJob.h"
+#include "exportScheduler.h"
+#include "targetRegistry.h"
+
+#include <QCommandLineParser>
+#include <QFile>
+#include <QFileInfo>
+#include <QGuiApplication>
+#include <QStandardPaths>
+
+#include <KDirWatch>
+
+#include <algorithm>
+#include <cstdio>
+
+// kolor-export: the same export the kded module does, without a session.
+// Meant for scripts and CI, it runs with the offscreen platform unless
+// QT_QPA_PLATFORM says otherwise.
+
+namespace
+{
+// same as the module's default ExportDelay
+constexpr int watchDelay = 250;
+
+struct Options {
+    KSharedConfigPtr colors;
+    // the file colors is read from, for --watch
+    QString colorsPath;
+    // kolorexporterrc or --config, read again by every export with --watch
+    KSharedConfigPtr config;
+    QString configPath;
+    // --target, every available target if empty
+    QStringList targetNames;
+    QList<ExportTarget> targets;
+    // installed or not and whatever --target says, for the links
+    QList<ExportTarget> allTargets;
+    RampSettings ramps;
+    // --stdout renders this instead of writing the targets
+    bool toStdout = false;
+    PaletteId palette = KdePalette;
+    std::shared_ptr<const OutputTemplate> outputTemplate;
+};
+
+void printError(const QString &message)
+{
+    std::fprintf(stderr, "kolor-export: %s\n", qUtf8Printable(message));
+}
+
+bool renderToStdout(const Options &options, const ColorSchemeSet &schemes)
+{
+    QByteArray output;
+    options.outputTemplate->render(computePalette(options.palette, schemes, options.ramps), output);
+    return std::fwrite(output.constData(), 1, output.size(), stdout) == size_t(output.size()) && std::fflush(stdout) == 0;
+}
+
+bool exportTargets(const Options &options, const ColorSchemeSet &schemes)
+{
+    ExportSnapshot snapshot;
+    snapshot.generation = 1;
+    snapshot.targets = options.targets;
+    snapshot.allTargets = options.allTargets;
+    // only the palettes some target uses, a container usually has one or two
+    std::array<bool, PaletteCount> needed = {};
+    for (const ExportTarget &target : std::as_const(snapshot.targets)) {
+        needed[target.palette] = true;
+    }
+    for (int id = 0; id < PaletteCount; id++) {
+        if (needed[id]) {
+            snapshot.palettes[id] = computePalette(PaletteId(id), schemes, options.ramps);
+        }
+    }
+
+    // runs right here, there's nothing else to do while it does
+    bool ok = true;
+    ExportJob job(std::move(snapshot), std::make_shared<std::atomic<quint64>>(1), [&ok](const ExportResult &result) {
+        for (const ExportTargetResult &target : result.targets) {
+            if (target.status == ExportTargetResult::Failed) {
+                printError(QStringLiteral("failed to write %1 (%2)").arg(target.path, target.name));
+                ok = false;
+            }
+        }
+    });
+    job.run();
+    return ok;
+}
+
+// the ramps and targets of options.config, false if a --target isn't one of them
+bool loadSettings(Options &options)
+{
+    options.ramps = loadRampSettings(options.config);
+    if (options.toStdout) {
+        return true;
+    }
+
+    TargetRegistry registry;
+    registry.setTargets(loadExportTargets(options.config));
+    options.targets = registry.availableTargets();
+    options.allTargets = registry.targets();
+
+    bool ok = true;
+    for (const QString &name : std::as_const(options.targetNames)) {
+        const QList<ExportTarget> &all = registry.targets();
+        if (std::none_of(all.cbegin(), all.cend(), [&name](const ExportTarget &target) {
+                return target.name == name;
+            })) {
+            printError(QStringLiteral("unknown target %1").arg(name));
+            ok = false;
+            continue;
+        }
+        // not a failure, it's what the module does too
+        if (!registry.isAvailable(name)) {
+            printError(QStringLiteral("%1 isn't installed, skipping it").arg(name));
+        }
+    }
+    if (!options.targetNames.isEmpty()) {
+        options.targets.removeIf([&options](const ExportTarget &target) {
+            return !options.targetNames.contains(target.name);
+        });
+    }
+    return ok;
+}
+
+bool runExport(const Options &options)
+{
+    const ColorSchemeSet schemes(options.colors);
+    return options.toStdout ? renderToStdout(options, schemes) : exportTargets(options, schemes);
+}
+}
+
+int main(int argc, char **argv)
+{
+    // KColorScheme needs a QGuiApplication, but not a display
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QGuiApplication app(argc, argv);
+    QGuiApplication::setApplicationName(QStringLiteral("kolor-export"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Exports the KDE color scheme to the files configured in kolorexporterrc"));
+    parser.addHelpOption();
+    const QCommandLineOption schemeOption(QStringLiteral("scheme"), QStringLiteral("Read the colors from a .colors file instead of kdeglobals."), QStringLiteral("file"));
+    const QCommandLineOption configOption(QStringLiteral("config"), QStringLiteral("Read the targets and ramps from this file instead of kolorexporterrc."), QStringLiteral("file"));
+    const QCommandLineOption targetOption(QStringLiteral("target"), QStringLiteral("Only export this target, can be given more than once."), QStringLiteral("name"));
+    const QCommandLineOption stdoutOption(QStringLiteral("stdout"), QStringLiteral("Print one template instead of writing the targets."));
+    const QCommandLineOption templateOption(QStringLiteral("template"), QStringLiteral("Template for --stdout, a name or a path."), QStringLiteral("name"), QStringLiteral("css"));
+    const QCommandLineOption paletteOption(QStringLiteral("palette"), QStringLiteral("Palette for --stdout: kde, discord or ramps."), QStringLiteral("name"), QStringLiteral("kde"));
+    const QCommandLineOption watchOption(QStringLiteral("watch"), QStringLiteral("Keep running and export again whenever the colors or the config change."));
+    parser.addOptions({schemeOption, configOption, targetOption, stdoutOption, templateOption, paletteOption, watchOption});
+    parser.process(app);
+
+    Options options;
+    if (parser.isSet(schemeOption)) {
+        options.colorsPath = QFileInfo(parser.value(schemeOption)).absoluteFilePath();
+        if (!QFile::exists(options.colorsPath)) {
+            printError(QStringLiteral("%1 doesn't exist").arg(options.colorsPath));
+            return 1;
+        }
+        options.colors = KSharedConfig::openConfig(options.colorsPath, KConfig::SimpleConfig);
+    } else {
+        options.colorsPath = QStandardPaths::writableLocation(QStandardPaths::GenericConfigLocation) + QStringLiteral("/kdeglobals");
+        options.colors = KSharedConfig::openConfig();
+    }
+
+    if (parser.isSet(configOption)) {
+        options.configPath = QFileInfo(parser.value(configOption)).absoluteFilePath();
+        options.config = KSharedConfig::openConfig(options.configPath, KConfig::SimpleConfig);
+    } else {
+        options.configPath = QStandardPaths::writableLocation(QStandardPaths::GenericConfigLocation) + QStringLiteral("/kolorexporterrc");
+        options.config = KSharedConfig::openConfig(QStringLiteral("kolorexporterrc"));
+    }
+    options.targetNames = parser.values(targetOption);
+
+    options.toStdout = parser.isSet(stdoutOption);
+    if (options.toStdout) {
+        const std::optional<PaletteId> palette = paletteFromName(parser.value(paletteOption));
+        if (!palette) {
+            printError(QStringLiteral("unknown palette %1").arg(parser.value(paletteOption)));
+            return 1;
+        }
+        options.palette = *palette;
+
+        QHash<QString, std::shared_ptr<const OutputTemplate>> templates;
+        options.outputTemplate = loadTemplate(parser.value(templateOption), templates);
+        if (!options.outputTemplate) {
+            printError(QStringLiteral("can't load template %1").arg(parser.value(templateOption)));
+            return 1;
+        }
+    }
+    if (!loadSettings(options)) {
+        return 1;
+    }
+
+    const bool ok = runExport(options);
+    if (!parser.isSet(watchOption)) {
+        return ok ? 0 : 1;
+    }
+
+    // editors and KConfig replace the file instead of writing to it, so created counts too.
+    // the config is watched as well, a new target or template is exported right away
+    KDirWatch watch;
+    watch.addFile(options.colorsPath);
+    watch.addFile(options.configPath);
+    ExportScheduler scheduler;
+    scheduler.setInterval(watchDelay);
+    QObject::connect(&watch, &KDirWatch::dirty, &scheduler, &ExportScheduler::schedule);
+    QObject::connect(&watch, &KDirWatch::created, &scheduler, &ExportScheduler::schedule);
+    QObject::connect(&scheduler, &ExportScheduler::exportRequested, &app, [&options]() {
+        options.colors->reparseConfiguration();
+        options.config->reparseConfiguration();
+        // a --target that was taken out of the config is reported, the others are still exported
+        loadSettings(options);
+        runExport(options);
+    });
+    return app.exec();
+}
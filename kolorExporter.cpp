@@ -1,399 +1,440 @@
 #include "kolorExporter.h"
+#include "kolorExporterDebug.h"
 
-#include <QFile>
+#include <QElapsedTimer>
+#include <QStandardPaths>
+#include <QTimer>
 
-#include <KColorScheme>
-#include <KColorUtils>
-#include <KConfig>
 #include <KConfigGroup>
 #include <KPluginFactory>
 
-#include <QFileInfo>
+#include <algorithm>
 
 K_PLUGIN_CLASS_WITH_JSON(kolorExporter, "kolorExporter.json")
 
+namespace
+{
+// reading back the exported files and exporting the other schemes can wait until the session is up
+constexpr int deferredStartupDelay = 10000;
+// installing a scheme pack writes lots of files in a row
+constexpr int schemeBatchDelay = 1000;
+
+// before is empty the first time, then every color counts as changed
+bool usesChangedColor(const OutputTemplate &outputTemplate, const Palette &before, const Palette &after)
+{
+    for (const Palette::Entry &entry : after) {
+        const QColor *previous = before.find(entry.name);
+        if ((!previous || *previous != entry.color) && outputTemplate.usesColor(entry.name)) {
+            return true;
+        }
+    }
+    return false;
+}
+}
+
 kolorExporter::kolorExporter(QObject *parent, const QVariantList &)
     : KDEDModule(parent)
     , kdeglobalsConfigWatcher(KConfigWatcher::create(KSharedConfig::openConfig()))
     , kdeglobalsConfig(KSharedConfig::openConfig())
+    , exporterConfig(KSharedConfig::openConfig(QStringLiteral("kolorexporterrc")))
+    , latestGeneration(std::make_shared<std::atomic<quint64>>(0))
 {
+    // one export at a time, a queued export that got superseded just returns early
+    exportPool.setMaxThreadCount(1);
+
     connect(kdeglobalsConfigWatcher.data(), &KConfigWatcher::configChanged, this, &kolorExporter::onKdeglobalsSettingsChange);
 
-    setColors();
+    // kolorexporterrc is usually edited by hand, so watch the file instead of waiting for KConfig notifications
+    const QString exporterConfigPath = QStandardPaths::writableLocation(QStandardPaths::GenericConfigLocation) + QStringLiteral("/kolorexporterrc");
+    exporterConfigFileWatch.addFile(exporterConfigPath);
+    auto reloadSettings = [this]() {
+        exporterConfig->reparseConfiguration();
+        loadSettings();
+        markAllTargetsStale();
+        exportScheduler.schedule();
+        schemeBatchScheduler.schedule();
+    };
+    connect(&exporterConfigFileWatch, &KDirWatch::dirty, this, reloadSettings);
+    connect(&exporterConfigFileWatch, &KDirWatch::created, this, reloadSettings);
+    connect(&exporterConfigFileWatch, &KDirWatch::deleted, this, reloadSettings);
+    connect(&exportScheduler, &ExportScheduler::exportRequested, this, &kolorExporter::setColors);
+    connect(&targetRegistry, &TargetRegistry::targetsAppeared, this, &kolorExporter::onTargetsAppeared);
+
+    const QStringList schemeDirectories = SchemeBatch::schemeDirectories();
+    for (const QString &directory : schemeDirectories) {
+        schemeDirectoryWatch.addDir(directory, KDirWatch::WatchFiles);
+    }
+    connect(&schemeDirectoryWatch, &KDirWatch::dirty, &schemeBatchScheduler, &ExportScheduler::schedule);
+    connect(&schemeDirectoryWatch, &KDirWatch::created, &schemeBatchScheduler, &ExportScheduler::schedule);
+    connect(&schemeDirectoryWatch, &KDirWatch::deleted, &schemeBatchScheduler, &ExportScheduler::schedule);
+    schemeBatchScheduler.setInterval(schemeBatchDelay);
+    connect(&schemeBatchScheduler, &ExportScheduler::exportRequested, this, &kolorExporter::exportAllSchemes);
+    connect(&schemeBatch, &SchemeBatch::finished, this, &kolorExporter::onSchemeBatchFinished);
+
+    connect(&paletteServer, &PaletteServer::palettesNeeded, this, &kolorExporter::publishPalettes);
+    paletteServer.listen(PaletteServer::defaultSocketName());
+
+    loadSettings();
+
+    // kded loads us while the session starts, and usually nothing changed since the last one
+    if (exportCache.isUpToDate(ExportCache::inputsHash(kdeglobalsConfig, rampSettings, enabledTargets()))) {
+        qCDebug(KOLOR_EXPORTER) << "Exported files are up to date, skipping the startup export";
+        QTimer::singleShot(deferredStartupDelay, Qt::VeryCoarseTimer, this, &kolorExporter::verifyCachedExport);
+    } else {
+        markAllTargetsStale();
+        setColors();
+    }
+
+    // unchanged schemes are skipped after a stat, but that's still hundreds of files
+    QTimer::singleShot(deferredStartupDelay, Qt::VeryCoarseTimer, this, &kolorExporter::exportAllSchemes);
 }
 
-void kolorExporter::setColors() const
+void kolorExporter::verifyCachedExport()
 {
-    const QMap<QString, QColor> colors = getColors();
-    QString cfgDir = QStandardPaths::writableLocation(QStandardPaths::GenericConfigLocation);
-    QString dataDir = QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation);
-    QString homeDir = QStandardPaths::writableLocation(QStandardPaths::HomeLocation);
-    writeCssColorsToFile(colors,
-                         cfgDir + QStringLiteral("/kde-colors.css"), // ~/.config/kde-colors.css
-                         ":root",
-                         "--");
-
-    // rofi
-    writeCssColorsToFile(colors,
-                         dataDir + QStringLiteral("/rofi/themes/kde-colors.rasi"), // ~/.local/share/rofi/themes/kde-colors.rasi
-                         "*",
-                         "");
-
-    const QMap<QString, QColor> discordColors = getDiscordColors();
-
-    // possible vencord installations
-    QStringList discordConfigPaths = {
-        // vencord installed on vanilla discord
-        cfgDir + QStringLiteral("/Vencord"),
-        homeDir + QStringLiteral("/.var/app/com.discordapp.Discord/config/Vencord"),
-        // vesktop
-        cfgDir + QStringLiteral("/vesktop"),
-        homeDir + QStringLiteral("/.var/app/dev.vencord.Vesktop/config/vesktop"),
-    };
+    // something already triggered an export, that one takes care of everything
+    if (latestGeneration->load() != 0) {
+        return;
+    }
 
-    for (auto path : discordConfigPaths) {
-        if (!QFileInfo(path).isDir())
-            continue;
-        writeCssColorsToFile(discordColors, path + QStringLiteral("/themes/kde-colors.css"), "*", "--", true);
+    if (!exportCache.verifyOutputs(enabledTargets())) {
+        markAllTargetsStale();
+        setColors();
+    }
+}
+
+void kolorExporter::loadSettings()
+{
+    // how long to wait for more changes before exporting, applying a global theme
+    // or dragging the accent picker fires lots of config changes in a row
+    const KConfigGroup general = exporterConfig->group(QStringLiteral("General"));
+    exportScheduler.setInterval(general.readEntry("ExportDelay", 250));
+
+    // only reopened when the path changes, the trace is truncated on every open
+    const QString eventTrace = expandHome(general.readPathEntry("RecordEvents", QString()));
+    if (eventTrace.isEmpty()) {
+        eventRecorder.reset();
+    } else if (!eventRecorder || eventRecorder->fileName() != eventTrace) {
+        eventRecorder = std::make_unique<EventRecorder>();
+        if (!eventRecorder->open(eventTrace, QStandardPaths::writableLocation(QStandardPaths::GenericConfigLocation) + QStringLiteral("/kdeglobals"))) {
+            eventRecorder.reset();
+        }
     }
+
+    // other roles or stops are different colors, not changed ones
+    const RampSettings ramps = loadRampSettings(exporterConfig);
+    if (ramps != rampSettings) {
+        rampSettings = ramps;
+        palettes[RampPalette] = Palette();
+        changedInputs = AllPaletteInputs;
+    }
+
+    targetRegistry.setTargets(loadExportTargets(exporterConfig));
+    schemeExportSettings = loadSchemeExportSettings(exporterConfig);
+}
+
+QList<ExportTarget> kolorExporter::enabledTargets() const
+{
+    QList<ExportTarget> targets = targetRegistry.targets();
+    targets.removeIf([this](const ExportTarget &target) {
+        return runtimeDisabledTargets.contains(target.name);
+    });
+    return targets;
+}
+
+void kolorExporter::setColors()
+{
+    // the cache is keyed on every enabled target, installed or not, so it matches
+    // what the next start computes before knowing what's installed
+    exportedInputs = ExportCache::inputsHash(kdeglobalsConfig, rampSettings, enabledTargets());
+
+    updatePalettes();
+
+    QList<ExportTarget> targets = targetRegistry.availableTargets();
+    targets.removeIf([this](const ExportTarget &target) {
+        return runtimeDisabledTargets.contains(target.name);
+    });
+    const qsizetype availableCount = targets.size();
+    // files that don't use any of the changed colors are already right
+    targets.removeIf([this](const ExportTarget &target) {
+        return !staleTargets.contains(target.name);
+    });
+    const ExportKind kind = targets.size() == availableCount ? FullExport : IncrementalExport;
+    startExport(std::move(targets), kind);
+}
+
+void kolorExporter::onTargetsAppeared(const QList<ExportTarget> &targets)
+{
+    QList<ExportTarget> enabled = targets;
+    enabled.removeIf([this](const ExportTarget &target) {
+        return runtimeDisabledTargets.contains(target.name);
+    });
+
+    // the other targets are up to date, no need to rewrite them
+    if (!enabled.isEmpty()) {
+        startExport(std::move(enabled), PartialExport);
+    }
+}
+
+void kolorExporter::startExport(QList<ExportTarget> targets, ExportKind kind)
+{
+    // palettes are computed here since they read kdeglobalsConfig, which is shared with
+    // KConfigWatcher and can't be used from another thread. Rendering and writing the
+    // files happens on exportPool
+    updatePalettes();
+
+    ExportSnapshot snapshot;
+    // a partial export shares the generation of the latest full one so it doesn't
+    // cancel it, and gets cancelled by the next one like it would
+    snapshot.generation = latestGeneration->load() + (kind == PartialExport ? 0 : 1);
+    snapshot.palettes = palettes;
+    snapshot.targets = std::move(targets);
+    snapshot.allTargets = enabledTargets();
+
+    // any job still queued or running for an older generation drops the rest of its work
+    latestGeneration->store(snapshot.generation);
+    Q_EMIT exportStarted(snapshot.generation);
+
+    const quint64 version = outputVersion;
+    exportPool.start(new ExportJob(std::move(snapshot), latestGeneration, [this, kind, version](const ExportResult &result) {
+        QMetaObject::invokeMethod(
+            this,
+            [this, result, kind, version]() {
+                onExportFinished(result, kind, version);
+            },
+            Qt::QueuedConnection);
+    }));
 }
 
-void kolorExporter::writeCssColorsToFile(QMap<QString, QColor> colors, QString path, QString rootPrefix, QString varPrefix, bool important) const
+void kolorExporter::updatePalettes()
 {
-    QFile colorsCss(path);
+    if (changedInputs == 0) {
+        return;
+    }
 
-    if (colorsCss.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
-        QTextStream colorsCssStream(&colorsCss);
+    QElapsedTimer timer;
+    timer.start();
 
-        colorsCssStream << QStringLiteral("%1 {\n").arg(rootPrefix);
-        for (auto it = colors.cbegin(); it != colors.cend(); it++) {
-            colorsCssStream << "    ";
-            colorsCssStream << varPrefix << it.key();
-            colorsCssStream << ": " << it.value().name();
+    const ColorSchemeSet schemes(kdeglobalsConfig);
+    const QList<ExportTarget> &targets = targetRegistry.targets();
+    const quint64 version = ++outputVersion;
+    int recomputed = 0;
+    bool changed = false;
 
-            if (important) {
-                colorsCssStream << "!important";
+    for (int id = 0; id < PaletteCount; id++) {
+        Palette updated = palettes[id];
+        recomputed += updatePalette(PaletteId(id), schemes, rampSettings, changedInputs, updated);
+        if (updated == palettes[id]) {
+            continue;
+        }
+
+        changed = true;
+        for (const ExportTarget &target : targets) {
+            if (target.palette == id && usesChangedColor(*target.outputTemplate, palettes[id], updated)) {
+                staleTargets.insert(target.name, version);
             }
-            colorsCssStream << ";\n";
         }
-        colorsCssStream << "}\n";
+        palettes[id] = updated;
+    }
+
+    changedInputs = 0;
+    lastRecomputedColors = recomputed;
+    recomputedColors += recomputed;
+    paletteLatency.add(timer.nsecsElapsed());
+
+    if (changed) {
+        Q_EMIT paletteChanged();
+        // only queued on the sockets, before the files so subscribers are never behind them
+        paletteServer.publish(palettes);
     }
 }
 
-void kolorExporter::onKdeglobalsSettingsChange(const KConfigGroup &group, const QByteArrayList &names) const
+void kolorExporter::markAllTargetsStale()
 {
-    if (group.name() == QStringLiteral("General")) {
-        if (names.contains(QByteArrayLiteral("ColorScheme")) || names.contains(QByteArrayLiteral("AccentColor"))) {
-            setColors();
-        }
+    const quint64 version = ++outputVersion;
+    for (const ExportTarget &target : targetRegistry.targets()) {
+        staleTargets.insert(target.name, version);
     }
 }
 
-// copied from https://invent.kde.org/plasma/kde-gtk-config/-/blob/master/kded/configvalueprovider.cpp
+void kolorExporter::publishPalettes()
+{
+    updatePalettes();
+    paletteServer.publish(palettes);
+}
 
-QMap<QString, QColor> kolorExporter::getColors() const
+void kolorExporter::onExportFinished(const ExportResult &result, ExportKind kind, quint64 exportedVersion)
 {
-    using KCS = KColorScheme;
-
-    // Color Schemes Collection
-    QHash<QString, QHash<QString, KCS>> csc{
-        {QStringLiteral("active"),
-         {
-             {QStringLiteral("view"), KCS(QPalette::Active, KCS::View)},
-             {QStringLiteral("window"), KCS(QPalette::Active, KCS::Window)},
-             {QStringLiteral("button"), KCS(QPalette::Active, KCS::Button)},
-             {QStringLiteral("selection"), KCS(QPalette::Active, KCS::Selection)},
-             {QStringLiteral("tooltip"), KCS(QPalette::Active, KCS::Tooltip)},
-             {QStringLiteral("complementary"), KCS(QPalette::Active, KCS::Complementary)},
-             {QStringLiteral("header"), KCS(QPalette::Active, KCS::Header)},
-         }},
-        {QStringLiteral("inactive"),
-         {
-             {QStringLiteral("view"), KCS(QPalette::Inactive, KCS::View)},
-             {QStringLiteral("window"), KCS(QPalette::Inactive, KCS::Window)},
-             {QStringLiteral("button"), KCS(QPalette::Inactive, KCS::Button)},
-             {QStringLiteral("selection"), KCS(QPalette::Inactive, KCS::Selection)},
-             {QStringLiteral("tooltip"), KCS(QPalette::Inactive, KCS::Tooltip)},
-             {QStringLiteral("complementary"), KCS(QPalette::Inactive, KCS::Complementary)},
-             {QStringLiteral("header"), KCS(QPalette::Inactive, KCS::Header)},
-         }},
-        {QStringLiteral("disabled"),
-         {
-             {QStringLiteral("view"), KCS(QPalette::Disabled, KCS::View)},
-             {QStringLiteral("window"), KCS(QPalette::Disabled, KCS::Window)},
-             {QStringLiteral("button"), KCS(QPalette::Disabled, KCS::Button)},
-             {QStringLiteral("selection"), KCS(QPalette::Disabled, KCS::Selection)},
-             {QStringLiteral("tooltip"), KCS(QPalette::Disabled, KCS::Tooltip)},
-             {QStringLiteral("complementary"), KCS(QPalette::Disabled, KCS::Complementary)},
-             {QStringLiteral("header"), KCS(QPalette::Disabled, KCS::Header)},
-         }},
-    };
+    for (const ExportTargetResult &target : result.targets) {
+        // unless something made it stale again while the job was running. A failed
+        // target is written again by the next export, even a partial one's
+        if (target.status == ExportTargetResult::Failed) {
+            staleTargets.insert(target.name, outputVersion);
+        } else if (staleTargets.value(target.name) <= exportedVersion) {
+            staleTargets.remove(target.name);
+        }
 
-    // Color mixing
-    QColor windowForegroundColor = csc["active"]["window"].foreground(KCS::NormalText).color();
-    QColor windowBackgroundColor = csc["active"]["window"].background(KCS::NormalBackground).color();
-    QColor bordersColor = KColorUtils::mix(windowBackgroundColor, windowForegroundColor, 0.25);
-
-    QColor inactiveWindowForegroundColor = csc["inactive"]["window"].foreground(KCS::NormalText).color();
-    QColor inactiveWindowBackgroundColor = csc["inactive"]["window"].background(KCS::NormalBackground).color();
-    QColor inactiveBordersColor = KColorUtils::mix(inactiveWindowBackgroundColor, inactiveWindowForegroundColor, 0.25);
-
-    QColor disabledWindowForegroundColor = csc["disabled"]["window"].foreground(KCS::NormalText).color();
-    QColor disabledWindowBackgroundColor = csc["disabled"]["window"].background(KCS::NormalBackground).color();
-    QColor disabledBordersColor = KColorUtils::mix(disabledWindowBackgroundColor, disabledWindowForegroundColor, 0.25);
-
-    QColor unfocusedDisabledWindowForegroundColor = csc["disabled"]["window"].foreground(KCS::NormalText).color();
-    QColor unfocusedDisabledWindowBackgroundColor = csc["disabled"]["window"].background(KCS::NormalBackground).color();
-    QColor unfocusedDisabledBordersColor = KColorUtils::mix(unfocusedDisabledWindowBackgroundColor, unfocusedDisabledWindowForegroundColor, 0.25);
-
-    QColor tooltipForegroundColor = csc["active"]["tooltip"].foreground(KCS::NormalText).color();
-    QColor tooltipBackgroundColor = csc["active"]["tooltip"].background(KCS::NormalBackground).color();
-    QColor tooltipBorderColor = KColorUtils::mix(tooltipBackgroundColor, tooltipForegroundColor, 0.25);
-
-    KConfigGroup windowManagerConfig = kdeglobalsConfig->group(QStringLiteral("WM"));
-
-    QMap<QString, QColor> result = {
-        /*
-         * Normal (Non Backdrop, Non Insensitive)
-         */
-
-        // General Colors
-        {"theme-fg-color-breeze", csc["active"]["window"].foreground(KCS::NormalText).color()},
-        {"theme-bg-color-breeze", csc["active"]["window"].background(KCS::NormalBackground).color()},
-        {"theme-text-color-breeze", csc["active"]["view"].foreground(KCS::NormalText).color()},
-        {"theme-base-color-breeze", csc["active"]["view"].background(KCS::NormalBackground).color()},
-        {"theme-view-hover-decoration-color-breeze", csc["active"]["view"].decoration(KCS::HoverColor).color()},
-        {"theme-hovering-selected-bg-color-breeze", csc["active"]["selection"].decoration(KCS::HoverColor).color()},
-        {"theme-selected-bg-color-breeze", csc["active"]["selection"].background(KCS::NormalBackground).color()},
-        {"theme-selected-fg-color-breeze", csc["active"]["selection"].foreground(KCS::NormalText).color()},
-        {"theme-view-active-decoration-color-breeze", csc["active"]["view"].decoration(KCS::HoverColor).color()},
-
-        // Button Colors
-        {"theme-button-background-normal-breeze", csc["active"]["button"].background(KCS::NormalBackground).color()},
-        {"theme-button-decoration-hover-breeze", csc["active"]["button"].decoration(KCS::HoverColor).color()},
-        {"theme-button-decoration-focus-breeze", csc["active"]["button"].decoration(KCS::FocusColor).color()},
-        {"theme-button-foreground-normal-breeze", csc["active"]["button"].foreground(KCS::NormalText).color()},
-        {"theme-button-foreground-active-breeze", csc["active"]["selection"].foreground(KCS::NormalText).color()},
-
-        // Misc Colors
-        {"borders-breeze", bordersColor},
-        {"warning-color-breeze", csc["active"]["view"].foreground(KCS::NeutralText).color()},
-        {"success-color-breeze", csc["active"]["view"].foreground(KCS::PositiveText).color()},
-        {"error-color-breeze", csc["active"]["view"].foreground(KCS::NegativeText).color()},
-
-        /*
-         * Backdrop (Inactive)
-         */
-
-        // General
-        {"theme-unfocused-fg-color-breeze", csc["inactive"]["window"].foreground(KCS::NormalText).color()},
-        {"theme-unfocused-text-color-breeze", csc["inactive"]["view"].foreground(KCS::NormalText).color()},
-        {"theme-unfocused-bg-color-breeze", csc["inactive"]["window"].background(KCS::NormalBackground).color()},
-        {"theme-unfocused-base-color-breeze", csc["inactive"]["view"].background(KCS::NormalBackground).color()},
-        {"theme-unfocused-selected-bg-color-alt-breeze", csc["inactive"]["selection"].background(KCS::NormalBackground).color()},
-        {"theme-unfocused-selected-bg-color-breeze", csc["inactive"]["selection"].background(KCS::NormalBackground).color()},
-        {"theme-unfocused-selected-fg-color-breeze", csc["inactive"]["selection"].foreground(KCS::NormalText).color()},
-
-        // Button
-        {"theme-button-background-backdrop-breeze", csc["inactive"]["button"].background(KCS::NormalBackground).color()},
-        {"theme-button-decoration-hover-backdrop-breeze", csc["inactive"]["button"].decoration(KCS::HoverColor).color()},
-        {"theme-button-decoration-focus-backdrop-breeze", csc["inactive"]["button"].decoration(KCS::FocusColor).color()},
-        {"theme-button-foreground-backdrop-breeze", csc["inactive"]["button"].foreground(KCS::NormalText).color()},
-        {"theme-button-foreground-active-backdrop-breeze", csc["inactive"]["selection"].foreground(KCS::NormalText).color()},
-
-        // Misc Colors
-        {"unfocused-borders-breeze", inactiveBordersColor},
-        {"warning-color-backdrop-breeze", csc["inactive"]["view"].foreground(KCS::NeutralText).color()},
-        {"success-color-backdrop-breeze", csc["inactive"]["view"].foreground(KCS::PositiveText).color()},
-        {"error-color-backdrop-breeze", csc["inactive"]["view"].foreground(KCS::NegativeText).color()},
-
-        /*
-         * Insensitive (Disabled)
-         */
-
-        // General
-        {"insensitive-fg-color-breeze", csc["disabled"]["window"].foreground(KCS::NormalText).color()},
-        {"insensitive-base-fg-color-breeze", csc["disabled"]["view"].foreground(KCS::NormalText).color()},
-        {"insensitive-bg-color-breeze", csc["disabled"]["window"].background(KCS::NormalBackground).color()},
-        {"insensitive-base-color-breeze", csc["disabled"]["view"].background(KCS::NormalBackground).color()},
-        {"insensitive-selected-bg-color-breeze", csc["disabled"]["selection"].background(KCS::NormalBackground).color()},
-        {"insensitive-selected-fg-color-breeze", csc["disabled"]["selection"].foreground(KCS::NormalText).color()},
-
-        // Button
-        {"theme-button-background-insensitive-breeze", csc["disabled"]["button"].background(KCS::NormalBackground).color()},
-        {"theme-button-decoration-hover-insensitive-breeze", csc["disabled"]["button"].decoration(KCS::HoverColor).color()},
-        {"theme-button-decoration-focus-insensitive-breeze", csc["disabled"]["button"].decoration(KCS::FocusColor).color()},
-        {"theme-button-foreground-insensitive-breeze", csc["disabled"]["button"].foreground(KCS::NormalText).color()},
-        {"theme-button-foreground-active-insensitive-breeze", csc["disabled"]["selection"].foreground(KCS::NormalText).color()},
-
-        // Misc Colors
-        {"insensitive-borders-breeze", disabledBordersColor},
-        {"warning-color-insensitive-breeze", csc["disabled"]["view"].foreground(KCS::NeutralText).color()},
-        {"success-color-insensitive-breeze", csc["disabled"]["view"].foreground(KCS::PositiveText).color()},
-        {"error-color-insensitive-breeze", csc["disabled"]["view"].foreground(KCS::NegativeText).color()},
-
-        /*
-         * Insensitive Backdrop (Inactive Disabled)
-         * These pretty much have the same appearance as regular inactive colors,
-         * but they're separate in case we decide to make them different in the
-         * future.
-         */
-
-        // General
-        {"insensitive-unfocused-fg-color-breeze", csc["disabled"]["window"].foreground(KCS::NormalText).color()},
-        {"theme-unfocused-view-text-color-breeze", csc["disabled"]["view"].foreground(KCS::NormalText).color()},
-        {"insensitive-unfocused-bg-color-breeze", csc["disabled"]["window"].background(KCS::NormalBackground).color()},
-        {"theme-unfocused-view-bg-color-breeze", csc["disabled"]["view"].background(KCS::NormalBackground).color()},
-        {"insensitive-unfocused-selected-bg-color-breeze", csc["disabled"]["selection"].background(KCS::NormalBackground).color()},
-        {"insensitive-unfocused-selected-fg-color-breeze", csc["disabled"]["selection"].foreground(KCS::NormalText).color()},
-
-        // Button
-        {"theme-button-background-backdrop-insensitive-breeze", csc["disabled"]["button"].background(KCS::NormalBackground).color()},
-        {"theme-button-decoration-hover-backdrop-insensitive-breeze", csc["disabled"]["button"].decoration(KCS::HoverColor).color()},
-        {"theme-button-decoration-focus-backdrop-insensitive-breeze", csc["disabled"]["button"].decoration(KCS::FocusColor).color()},
-        {"theme-button-foreground-backdrop-insensitive-breeze", csc["disabled"]["button"].foreground(KCS::NormalText).color()},
-        {"theme-button-foreground-active-backdrop-insensitive-breeze", csc["disabled"]["selection"].foreground(KCS::NormalText).color()},
-
-        // Misc Colors
-        {"unfocused-insensitive-borders-breeze", unfocusedDisabledBordersColor},
-        {"warning-color-insensitive-backdrop-breeze", csc["disabled"]["view"].foreground(KCS::NeutralText).color()},
-        {"success-color-insensitive-backdrop-breeze", csc["disabled"]["view"].foreground(KCS::PositiveText).color()},
-        {"error-color-insensitive-backdrop-breeze", csc["disabled"]["view"].foreground(KCS::NegativeText).color()},
-
-        /*
-         * Ignorant Colors (These colors do not care about backdrop or insensitive
-         * states)
-         */
-
-        {"link-color-breeze", csc["active"]["view"].foreground(KCS::LinkText).color()},
-        {"link-visited-color-breeze", csc["active"]["view"].foreground(KCS::VisitedText).color()},
-
-        {"tooltip-text-breeze", tooltipForegroundColor},
-        {"tooltip-background-breeze", tooltipBackgroundColor},
-        {"tooltip-border-breeze", tooltipBorderColor},
-
-        {"content-view-bg-breeze", csc["active"]["view"].background(KCS::NormalBackground).color()},
+        TargetWriteStats &stats = writeStats[target.name];
+        switch (target.status) {
+        case ExportTargetResult::Written:
+            stats.written++;
+            break;
+        case ExportTargetResult::Skipped:
+            stats.skipped++;
+            break;
+        case ExportTargetResult::Failed:
+            stats.failed++;
+            break;
+        }
+        qCDebug(KOLOR_EXPORTER) << target.path << "written:" << stats.written << "skipped:" << stats.skipped;
+    }
 
-    };
-    // Handle Headers (menu bars and some of toolbars)
-    if (KCS::isColorSetSupported(kdeglobalsConfig, KCS::Header)) {
-        // If we have a separate Header color set, use it for both titlebar and
-        // header coloring...
-        result.insert({{"theme-header-background-breeze", csc["active"]["header"].background().color()},
-                       {"theme-header-foreground-breeze", csc["active"]["header"].foreground().color()},
-                       {"theme-header-background-light-breeze", csc["active"]["window"].background().color()},
-                       {"theme-header-foreground-backdrop-breeze", csc["inactive"]["header"].foreground().color()},
-                       {"theme-header-background-backdrop-breeze", csc["inactive"]["header"].background().color()},
-                       {"theme-header-foreground-insensitive-breeze", csc["inactive"]["header"].foreground().color()},
-                       {"theme-header-foreground-insensitive-backdrop-breeze", csc["inactive"]["header"].foreground().color()},
-
-                       {"theme-titlebar-background-breeze", csc["active"]["header"].background().color()},
-                       {"theme-titlebar-foreground-breeze", csc["active"]["header"].foreground().color()},
-                       {"theme-titlebar-background-light-breeze", csc["active"]["window"].background().color()},
-                       {"theme-titlebar-foreground-backdrop-breeze", csc["inactive"]["header"].foreground().color()},
-                       {"theme-titlebar-background-backdrop-breeze", csc["inactive"]["header"].background().color()},
-                       {"theme-titlebar-foreground-insensitive-breeze", csc["inactive"]["header"].foreground().color()},
-                       {"theme-titlebar-foreground-insensitive-backdrop-breeze", csc["inactive"]["header"].foreground().color()}});
+    bytesWritten += result.bytesWritten;
+    if (result.cancelled) {
+        cancelledExportCount++;
+        qCDebug(KOLOR_EXPORTER) << "Export" << result.generation << "was superseded by a newer one";
     } else {
-        //... if we don't we'll use regular window colors for headerbar and WM group
-        // for a titlebar
-        result.insert({
-            {"theme-header-background-breeze", csc["active"]["window"].background().color()},
-            {"theme-header-foreground-breeze", csc["active"]["window"].foreground().color()},
-            {"theme-header-background-light-breeze", csc["active"]["window"].background().color()},
-            {"theme-header-foreground-backdrop-breeze", csc["inactive"]["window"].foreground().color()},
-            {"theme-header-background-backdrop-breeze", csc["inactive"]["window"].background().color()},
-            {"theme-header-foreground-insensitive-breeze", csc["inactive"]["window"].foreground().color()},
-            {"theme-header-foreground-insensitive-backdrop-breeze", csc["inactive"]["window"].foreground().color()},
-
-            {"theme-titlebar-background-breeze", windowManagerConfig.readEntry("activeBackground", QColor())},
-            {"theme-titlebar-foreground-breeze", windowManagerConfig.readEntry("activeForeground", QColor())},
-            {"theme-titlebar-background-light-breeze", csc["active"]["window"].background(KCS::NormalBackground).color()},
-            {"theme-titlebar-foreground-backdrop-breeze", windowManagerConfig.readEntry("inactiveForeground", QColor())},
-            {"theme-titlebar-background-backdrop-breeze", windowManagerConfig.readEntry("inactiveBackground", QColor())},
-            {"theme-titlebar-foreground-insensitive-breeze", windowManagerConfig.readEntry("inactiveForeground", QColor())},
-            {"theme-titlebar-foreground-insensitive-backdrop-breeze", windowManagerConfig.readEntry("inactiveForeground", QColor())},
+        // cancelled jobs stop halfway, their timing would only skew the average
+        exportCount++;
+        ioLatency.add(result.elapsedNanoseconds);
+
+        const bool failed = std::any_of(result.targets.cbegin(), result.targets.cend(), [](const ExportTargetResult &target) {
+            return target.status == ExportTargetResult::Failed;
         });
+        // a failed target has to be retried on the next start, so don't cache the export
+        if (result.generation == latestGeneration->load() && !failed) {
+            switch (kind) {
+            case FullExport:
+                exportCache.store(exportedInputs, result.targets);
+                break;
+            case IncrementalExport:
+                exportCache.update(exportedInputs, result.targets);
+                break;
+            case PartialExport:
+                exportCache.update(result.targets);
+                break;
+            }
+        }
     }
 
-    return result;
+    Q_EMIT exportFinished(result.generation, result.cancelled);
 }
 
-QMap<QString, QColor> kolorExporter::getDiscordColors() const
+void kolorExporter::exportNow()
 {
-    using KCS = KColorScheme;
-
-    // Color Schemes Collection
-    QHash<QString, QHash<QString, KCS>> csc{
-        {QStringLiteral("active"),
-         {
-             {QStringLiteral("view"), KCS(QPalette::Active, KCS::View)},
-             {QStringLiteral("window"), KCS(QPalette::Active, KCS::Window)},
-             {QStringLiteral("button"), KCS(QPalette::Active, KCS::Button)},
-             {QStringLiteral("selection"), KCS(QPalette::Active, KCS::Selection)},
-             {QStringLiteral("tooltip"), KCS(QPalette::Active, KCS::Tooltip)},
-             {QStringLiteral("complementary"), KCS(QPalette::Active, KCS::Complementary)},
-             {QStringLiteral("header"), KCS(QPalette::Active, KCS::Header)},
-         }},
-    };
+    if (exportScheduler.isPending()) {
+        exportScheduler.flush();
+    } else {
+        // asked for explicitly, so every file is checked and not only the stale ones
+        markAllTargetsStale();
+        setColors();
+    }
+}
 
-    QMap<QString, QColor> result = {
-        {"background-primary", csc["active"]["window"].background(KCS::AlternateBackground).color()},
-        {"background-secondary", csc["active"]["view"].background(KCS::NormalBackground).color()},
-        {"modal-footer-background", csc["active"]["window"].background(KCS::NormalBackground).color()},
-        {"background-secondary-alt", csc["active"]["view"].background(KCS::NormalBackground).color()},
-        {"background-tertiary", csc["active"]["view"].background(KCS::AlternateBackground).color()},
-        {"background-accent", csc["active"]["window"].background(KCS::NormalBackground).color()},
-        {"background-floating", csc["active"]["window"].background(KCS::NormalBackground).color()},
-        {"background-modifier-selected", csc["active"]["window"].background(KCS::ActiveBackground).color()},
-        {"background-modifier-hover", csc["active"]["window"].background(KCS::ActiveBackground).color()},
-        {"background-modifier-active", csc["active"]["window"].background(KCS::ActiveBackground).color()},
-        {"modal-background", csc["active"]["window"].background(KCS::NormalBackground).color()},
-        {"home-background", csc["active"]["window"].background(KCS::AlternateBackground).color()},
-        {"scrollbar-thin-thumb", csc["active"]["selection"].background(KCS::NormalBackground).color()},
-        {"scrollbar-auto-thumb", csc["active"]["selection"].background(KCS::NormalBackground).color()},
-        {"scrollbar-auto-track", csc["active"]["window"].background(KCS::NormalBackground).color()},
-        {"scrollbar-auto-scrollbar-color-thumb", csc["active"]["selection"].background(KCS::NormalBackground).color()},
-        {"scrollbar-auto-scrollbar-color-track", csc["active"]["window"].background(KCS::NormalBackground).color()},
-        {"channeltextarea-background", csc["active"]["view"].background(KCS::NormalBackground).color()},
-        {"input-background", csc["active"]["view"].background(KCS::NormalBackground).color()},
-        {"background-nested-floating", csc["active"]["view"].background(KCS::AlternateBackground).color()},
-    };
+QStringList kolorExporter::targets() const
+{
+    QStringList names;
+    names.reserve(targetRegistry.targets().size());
+    for (const ExportTarget &target : targetRegistry.targets()) {
+        names.append(target.name);
+    }
+    return names;
+}
+
+QStringList kolorExporter::disabledTargets() const
+{
+    return QStringList(runtimeDisabledTargets.cbegin(), runtimeDisabledTargets.cend());
+}
 
-    QColor accent = csc["active"]["selection"].background(KCS::NormalBackground).color();
-    int accentHue = accent.hslHue();
-    int accentSaturation = accent.hslSaturation();
+bool kolorExporter::setTargetEnabled(const QString &name, bool enabled)
+{
+    const QList<ExportTarget> &targets = targetRegistry.targets();
+    const auto it = std::find_if(targets.cbegin(), targets.cend(), [&name](const ExportTarget &target) {
+        return target.name == name;
+    });
+    if (it == targets.cend()) {
+        return false;
+    }
 
-    QColor primary = csc["active"]["view"].background(KCS::AlternateBackground).color();
-    int primaryHue = primary.hslHue();
-    int primarySaturation = primary.hslSaturation();
+    if (enabled) {
+        // export so the re-enabled target catches up with the changes it missed
+        if (runtimeDisabledTargets.remove(name) && targetRegistry.isAvailable(name)) {
+            startExport(QList<ExportTarget>{*it}, PartialExport);
+        }
+    } else {
+        runtimeDisabledTargets.insert(name);
+    }
+    return true;
+}
 
-    // i love magic
-    auto superCoolEasingFunction = [](float x) {
-        return x < 0.5 ? pow(1.3, 20 * x - 10) / 2 : (2 - pow(1.3, -20 * x + 10)) / 2;
-    };
+QVariantMap kolorExporter::metrics() const
+{
+    QVariantMap targetStats;
+    for (auto it = writeStats.cbegin(); it != writeStats.cend(); ++it) {
+        targetStats.insert(it.key(),
+                           QVariantMap{
+                               {QStringLiteral("written"), it->written},
+                               {QStringLiteral("skipped"), it->skipped},
+                               {QStringLiteral("failed"), it->failed},
+                           });
+    }
 
-    int colorIds[27] = {
-        100, 130, 160, 200, 230, 260, 300, 330, 345, 360, 400, 430, 460, 500, 530, 560, 600, 630, 645, 660, 700, 730, 760, 800, 830, 860, 900,
+    // D-Bus clients get microseconds, nanoseconds are more precision than any of this needs
+    return QVariantMap{
+        {QStringLiteral("exports"), exportCount},
+        {QStringLiteral("cancelledExports"), cancelledExportCount},
+        {QStringLiteral("bytesWritten"), bytesWritten},
+        {QStringLiteral("recomputedColors"), recomputedColors},
+        {QStringLiteral("lastRecomputedColors"), lastRecomputedColors},
+        {QStringLiteral("lastPaletteUsec"), paletteLatency.last / 1000},
+        {QStringLiteral("averagePaletteUsec"), paletteLatency.average / 1000},
+        {QStringLiteral("lastIoUsec"), ioLatency.last / 1000},
+        {QStringLiteral("averageIoUsec"), ioLatency.average / 1000},
+        {QStringLiteral("targets"), targetStats},
+        {QStringLiteral("paletteVersion"), paletteServer.version()},
+        {QStringLiteral("subscribers"), qlonglong(paletteServer.subscriberCount())},
+        {QStringLiteral("droppedSubscribers"), paletteServer.droppedSubscriberCount()},
     };
+}
 
-    for (int colorId : colorIds) {
-        // the css variables go from almost white (eg. --brand-100) to almost black (--brand-900)
-        float t = colorId / 900.f;
-        int lightness = abs((t * 255) - 255);
+void kolorExporter::exportAllSchemes()
+{
+    if (schemeExportSettings.isEnabled()) {
+        schemeBatch.start(schemeExportSettings, SchemeBatch::findSchemes(SchemeBatch::schemeDirectories()));
+    }
+}
 
-        QColor brandColor = QColor::fromHsl(accentHue, accentSaturation, lightness);
-        QString brandId = QStringLiteral("brand-%1").arg(colorId);
-        result.insert(brandId, brandColor);
+void kolorExporter::onSchemeBatchFinished(const SchemeBatch::Result &result)
+{
+    qCDebug(KOLOR_EXPORTER) << "Exported" << result.exported << "schemes," << result.unchanged << "unchanged," << result.removed << "removed,"
+                            << result.failed << "failed in" << result.elapsedNanoseconds / 1000000 << "ms";
+}
 
-        lightness = abs((superCoolEasingFunction(t) * 255) - 255);
+void kolorExporter::LatencyStats::add(qint64 nanoseconds)
+{
+    last = nanoseconds;
+    // exponential moving average, the first sample seeds it so it doesn't start from 0
+    average = average == 0 ? nanoseconds : average + (nanoseconds - average) / 16;
+}
 
-        QColor primaryColor = QColor::fromHsl(primaryHue, primarySaturation, lightness);
-        QString primaryId = QStringLiteral("primary-%1").arg(colorId);
-        result.insert(primaryId, primaryColor);
+void kolorExporter::onKdeglobalsSettingsChange(const KConfigGroup &group, const QByteArrayList &names)
+{
+    // nested groups like [Colors:Header][Inactive] are reported with their own name
+    KConfigGroup topLevelGroup = group;
+    while (topLevelGroup.parent().name() != QStringLiteral("<default>")) {
+        topLevelGroup = topLevelGroup.parent();
     }
 
-    return result;
+    // everything, even the groups that don't affect the colors, it's what a real session looks like
+    if (eventRecorder) {
+        eventRecorder->record(group, names);
+    }
+
+    // collected until the export runs, so a burst of changes is computed once
+    const PaletteInputs inputs = paletteInputsOf(topLevelGroup.name(), names);
+    if (inputs != 0) {
+        changedInputs |= inputs;
+        exportScheduler.schedule();
+    }
 }
 
 #include "kolorExporter.moc"
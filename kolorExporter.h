@@ -1,22 +1,138 @@
 #pragma once
 
+#include "eventTrace.h"
+#include "exportCache.h"
+#include "exportJob.h"
+#include "exportScheduler.h"
+#include "exportTarget.h"
+#include "paletteServer.h"
+#include "schemeBatch.h"
+#include "targetRegistry.h"
+
+#include <QHash>
+#include <QSet>
+#include <QThreadPool>
+#include <QVariantMap>
+
 #include <KConfigWatcher>
 #include <KDEDModule>
+#include <KDirWatch>
 
 class Q_DECL_EXPORT kolorExporter : public KDEDModule
 {
     Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.kde.kolorExporter")
 public:
     kolorExporter(QObject *parent, const QVariantList &args);
 
 public Q_SLOTS:
-    void onKdeglobalsSettingsChange(const KConfigGroup &group, const QByteArrayList &names) const;
+    void onKdeglobalsSettingsChange(const KConfigGroup &group, const QByteArrayList &names);
+
+    // the scriptable members are exported on the kded bus at /modules/kolor-exporter
+
+    // export right away, also runs an export that's still waiting for ExportDelay
+    Q_SCRIPTABLE void exportNow();
+    // names of the enabled targets in kolorexporterrc
+    Q_SCRIPTABLE QStringList targets() const;
+    Q_SCRIPTABLE QStringList disabledTargets() const;
+    // only lasts until kded restarts, kolorexporterrc isn't touched.
+    // false if there's no target with that name
+    Q_SCRIPTABLE bool setTargetEnabled(const QString &name, bool enabled);
+    // export counters and latencies, see README.md for the keys
+    Q_SCRIPTABLE QVariantMap metrics() const;
+    // export every installed color scheme now, if [Schemes] is set up in kolorexporterrc
+    Q_SCRIPTABLE void exportAllSchemes();
+
+Q_SIGNALS:
+    // the colors were computed, the files are written next. Same generation as the
+    // exportFinished() that follows
+    Q_SCRIPTABLE void exportStarted(quint64 generation);
+    // cancelled is true when a newer export replaced this one before it was done
+    Q_SCRIPTABLE void exportFinished(quint64 generation, bool cancelled);
+    // the colors differ from the previous export, emitted before the files are written
+    Q_SCRIPTABLE void paletteChanged();
 
 private:
-    void setColors() const;
-    void writeCssColorsToFile(QMap<QString, QColor> colors, QString path, QString rootPrefix, QString varPrefix, bool important = false) const;
+    struct TargetWriteStats {
+        quint64 written = 0;
+        quint64 skipped = 0;
+        quint64 failed = 0;
+    };
+
+    // last sample and a rolling average over roughly the last 16
+    struct LatencyStats {
+        qint64 last = 0;
+        qint64 average = 0;
+
+        void add(qint64 nanoseconds);
+    };
+
+    enum ExportKind {
+        // every target, at startup or after kolorexporterrc changed
+        FullExport,
+        // the targets using a color that changed
+        IncrementalExport,
+        // only some targets, e.g. an app that was just installed
+        PartialExport,
+    };
+
+    void loadSettings();
+    // enabled in kolorexporterrc and not disabled over D-Bus
+    QList<ExportTarget> enabledTargets() const;
+    void setColors();
+    void onTargetsAppeared(const QList<ExportTarget> &targets);
+    void startExport(QList<ExportTarget> targets, ExportKind kind);
+    // applies changedInputs to palettes, the targets using a color that changed become stale
+    void updatePalettes();
+    // their files have to be written again even if no color changed, e.g. a new template
+    void markAllTargetsStale();
+    // for subscribers that connected while the startup export was skipped
+    void publishPalettes();
+    void verifyCachedExport();
+    void onSchemeBatchFinished(const SchemeBatch::Result &result);
+    void onExportFinished(const ExportResult &result, ExportKind kind, quint64 exportedVersion);
     KConfigWatcher::Ptr kdeglobalsConfigWatcher;
-    QMap<QString, QColor> getColors() const;
-    QMap<QString, QColor> getDiscordColors() const;
     KSharedConfigPtr kdeglobalsConfig;
+    KSharedConfigPtr exporterConfig;
+    KDirWatch exporterConfigFileWatch;
+    ExportScheduler exportScheduler;
+    TargetRegistry targetRegistry;
+    // every installed scheme, not only the active one
+    SchemeExportSettings schemeExportSettings;
+    KDirWatch schemeDirectoryWatch;
+    ExportScheduler schemeBatchScheduler;
+    SchemeBatch schemeBatch;
+    // live updates for apps that would otherwise watch the exported files
+    PaletteServer paletteServer;
+    // every kdeglobals change, for replaying a session. Only while RecordEvents is set
+    std::unique_ptr<EventRecorder> eventRecorder;
+    // disabled over D-Bus, kept across reloads of kolorexporterrc
+    QSet<QString> runtimeDisabledTargets;
+    // the [Ramps] group of kolorexporterrc
+    RampSettings rampSettings;
+    // the colors as of the last updatePalettes(), and what changed in kdeglobals since
+    std::array<Palette, PaletteCount> palettes;
+    PaletteInputs changedInputs = AllPaletteInputs;
+    // bumped whenever what some target should contain changes
+    quint64 outputVersion = 0;
+    // targets whose file is behind, with the outputVersion that made them stale
+    QHash<QString, quint64> staleTargets;
+    ExportCache exportCache;
+    // inputs of the latest export, stored in exportCache once it's done
+    QByteArray exportedInputs;
+
+    // per target name, how many exports rewrote the file and how many left it untouched
+    QHash<QString, TargetWriteStats> writeStats;
+    quint64 exportCount = 0;
+    quint64 cancelledExportCount = 0;
+    quint64 bytesWritten = 0;
+    // colors computed by updatePalettes(), a change to one group should only touch a few
+    quint64 recomputedColors = 0;
+    int lastRecomputedColors = 0;
+    LatencyStats paletteLatency;
+    LatencyStats ioLatency;
+
+    std::shared_ptr<std::atomic<quint64>> latestGeneration;
+    // declared last so it's destroyed (and waits for the running job) before anything else
+    QThreadPool exportPool;
 };
@@ -0,0 +1,251 @@
+#include "outputTemplate.h"
+
+#include <QCryptographicHash>
+
+#include <algorithm>
+
+namespace
+{
+// rough size of a color name, only used to reserve the output buffer
+constexpr qsizetype averageNameSize = 40;
+constexpr qsizetype hexSize = 7;
+constexpr qsizetype rgbSize = 13;
+
+void appendDecimal(QByteArray &out, int value)
+{
+    char digits[3];
+    int count = 0;
+    do {
+        digits[count++] = char('0' + value % 10);
+        value /= 10;
+    } while (value > 0 && count < 3);
+
+    while (count > 0) {
+        out += digits[--count];
+    }
+}
+
+void appendRgbColor(QByteArray &out, const QColor &color)
+{
+    const QRgb rgb = color.rgb();
+    appendDecimal(out, qRed(rgb));
+    out += ", ";
+    appendDecimal(out, qGreen(rgb));
+    out += ", ";
+    appendDecimal(out, qBlue(rgb));
+}
+}
+
+OutputTemplate OutputTemplate::parse(QByteArrayView source)
+{
+    OutputTemplate result;
+    result.sourceChecksum = QCryptographicHash::hash(source, QCryptographicHash::Sha1);
+    qsizetype loopStart = -1;
+    qsizetype pos = 0;
+
+    while (pos < source.size()) {
+        const qsizetype open = source.indexOf("{{", pos);
+        if (open < 0) {
+            result.appendText(source.sliced(pos), loopStart >= 0);
+            break;
+        }
+        // \{{ is a literal {{
+        if (open > pos && source.at(open - 1) == '\\') {
+            result.appendText(source.sliced(pos, open - 1 - pos), loopStart >= 0);
+            result.appendText("{{", loopStart >= 0);
+            pos = open + 2;
+            continue;
+        }
+        result.appendText(source.sliced(pos, open - pos), loopStart >= 0);
+
+        const qsizetype close = source.indexOf("}}", open + 2);
+        if (close < 0) {
+            result.fail(QStringLiteral("Unterminated tag at offset %1").arg(open));
+            return result;
+        }
+        pos = close + 2;
+
+        const QByteArrayView tag = source.sliced(open + 2, close - open - 2).trimmed();
+        const qsizetype space = tag.indexOf(' ');
+        const QByteArrayView keyword = space < 0 ? tag : tag.first(space);
+        const QByteArrayView argument = space < 0 ? QByteArrayView() : tag.sliced(space + 1).trimmed();
+        const bool inLoop = loopStart >= 0;
+        // per color tokens count towards perColorSize, everything else is rendered once
+        qsizetype &size = inLoop ? result.perColorSize : result.fixedSize;
+
+        if (keyword == "#colors") {
+            if (inLoop) {
+                result.fail(QStringLiteral("{{#colors}} can't be nested"));
+                return result;
+            }
+            loopStart = result.tokens.size();
+            result.tokens.append(Token{Token::BeginColors, {}});
+        } else if (keyword == "/colors") {
+            if (!inLoop) {
+                result.fail(QStringLiteral("{{/colors}} without {{#colors}}"));
+                return result;
+            }
+            result.tokens[loopStart].end = result.tokens.size();
+            result.tokens.append(Token{Token::EndColors, {}});
+            loopStart = -1;
+        } else if ((keyword == "hex" || keyword == "rgb") && !argument.isEmpty()) {
+            const bool hex = keyword == "hex";
+            result.tokens.append(Token{hex ? Token::NamedHex : Token::NamedRgb, argument.toByteArray()});
+            size += hex ? hexSize : rgbSize;
+        } else if (keyword == "name" || keyword == "ident" || keyword == "hex" || keyword == "rgb" || keyword == "comma") {
+            if (!inLoop) {
+                result.fail(QStringLiteral("{{%1}} can only be used inside {{#colors}}").arg(QString::fromUtf8(keyword)));
+                return result;
+            }
+
+            if (keyword == "name") {
+                result.tokens.append(Token{Token::Name, {}});
+                size += averageNameSize;
+            } else if (keyword == "ident") {
+                result.tokens.append(Token{Token::Ident, {}});
+                size += averageNameSize;
+            } else if (keyword == "hex") {
+                result.tokens.append(Token{Token::Hex, {}});
+                size += hexSize;
+            } else if (keyword == "rgb") {
+                result.tokens.append(Token{Token::Rgb, {}});
+                size += rgbSize;
+            } else {
+                result.tokens.append(Token{Token::Comma, {}});
+                size += 1;
+            }
+        } else {
+            result.fail(QStringLiteral("Unknown tag {{%1}}").arg(QString::fromUtf8(tag)));
+            return result;
+        }
+    }
+
+    if (loopStart >= 0) {
+        result.fail(QStringLiteral("{{#colors}} is never closed"));
+    }
+
+    return result;
+}
+
+bool OutputTemplate::isValid() const
+{
+    return error.isEmpty();
+}
+
+QString OutputTemplate::errorString() const
+{
+    return error;
+}
+
+QByteArray OutputTemplate::checksum() const
+{
+    return sourceChecksum;
+}
+
+bool OutputTemplate::usesColor(QLatin1StringView name) const
+{
+    return std::any_of(tokens.cbegin(), tokens.cend(), [name](const Token &token) {
+        switch (token.kind) {
+        case Token::BeginColors:
+            return true;
+        case Token::NamedHex:
+        case Token::NamedRgb:
+            return QByteArrayView(token.text) == QByteArrayView(name.data(), name.size());
+        default:
+            return false;
+        }
+    });
+}
+
+QByteArrayList OutputTemplate::namedColors() const
+{
+    QByteArrayList names;
+    for (const Token &token : tokens) {
+        if ((token.kind == Token::NamedHex || token.kind == Token::NamedRgb) && !names.contains(token.text)) {
+            names.append(token.text);
+        }
+    }
+    return names;
+}
+
+void OutputTemplate::appendText(QByteArrayView text, bool inLoop)
+{
+    if (text.isEmpty()) {
+        return;
+    }
+
+    // text inside {{#colors}} is repeated for every color
+    (inLoop ? perColorSize : fixedSize) += text.size();
+
+    if (!tokens.isEmpty() && tokens.constLast().kind == Token::Text) {
+        tokens.last().text += text;
+    } else {
+        tokens.append(Token{Token::Text, text.toByteArray()});
+    }
+}
+
+void OutputTemplate::fail(const QString &message)
+{
+    error = message;
+    tokens.clear();
+}
+
+void OutputTemplate::render(const Palette &palette, QByteArray &out) const
+{
+    Q_ASSERT(isValid());
+    out.reserve(out.size() + fixedSize + perColorSize * palette.size());
+
+    for (qsizetype i = 0; i < tokens.size(); i++) {
+        const Token &token = tokens[i];
+        if (token.kind != Token::BeginColors) {
+            renderToken(token, palette, nullptr, false, out);
+            continue;
+        }
+
+        for (const Palette::Entry *entry = palette.begin(); entry != palette.end(); entry++) {
+            const bool last = entry + 1 == palette.end();
+            for (qsizetype j = i + 1; j < token.end; j++) {
+                renderToken(tokens[j], palette, entry, last, out);
+            }
+        }
+        i = token.end;
+    }
+}
+
+void OutputTemplate::renderToken(const Token &token, const Palette &palette, const Palette::Entry *entry, bool last, QByteArray &out)
+{
+    switch (token.kind) {
+    case Token::Text:
+        out += token.text;
+        break;
+    case Token::Name:
+        out.append(entry->name.data(), entry->name.size());
+        break;
+    case Token::Ident:
+        for (char c : entry->name) {
+            out += (c == '-' ? '_' : c);
+        }
+        break;
+    case Token::Hex:
+        appendHexColor(out, entry->color);
+        break;
+    case Token::Rgb:
+        appendRgbColor(out, entry->color);
+        break;
+    case Token::Comma:
+        if (!last) {
+            out += ',';
+        }
+        break;
+    case Token::NamedHex:
+    case Token::NamedRgb:
+        // colors that aren't in the palette render as nothing
+        if (const QColor *color = palette.find(QLatin1StringView(token.text))) {
+            token.kind == Token::NamedHex ? appendHexColor(out, *color) : appendRgbColor(out, *color);
+        }
+        break;
+    case Token::BeginColors:
+    case Token::EndColors:
+        break;
+    }
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "palette.h"
+
+#include <QByteArray>
+#include <QByteArrayList>
+#include <QByteArrayView>
+#include <QList>
+#include <QString>
+
+// A template for an exported file, parsed once into a list of tokens and then
+// rendered in a single pass for every export.
+//
+// Syntax:
+//   {{#colors}} ... {{/colors}}  repeats its content for every color of the palette
+//   {{name}}                     color name, e.g. theme-fg-color-breeze
+//   {{ident}}                    color name with dashes replaced by underscores
+//   {{hex}}                      color as #rrggbb
+//   {{rgb}}                      color as "r, g, b"
+//   {{comma}}                    a comma, except on the last color
+//   {{hex <name>}} {{rgb <name>}}  a specific color of the palette, can be used anywhere.
+//                                a name the palette doesn't have renders as nothing, and
+//                                loadExportTargets() warns about it
+//   \{{                          a literal {{
+class OutputTemplate
+{
+public:
+    static OutputTemplate parse(QByteArrayView source);
+
+    bool isValid() const;
+    QString errorString() const;
+    // of the source it was parsed from, so caches notice an edited template
+    QByteArray checksum() const;
+    // whether the rendered output contains this color, so it only has to be
+    // rendered again when one of the colors it uses changed
+    bool usesColor(QLatin1StringView name) const;
+    // the names of the {{hex <name>}} and {{rgb <name>}} tags, to check them against the palette
+    QByteArrayList namedColors() const;
+
+    // appends the rendered template to out
+    void render(const Palette &palette, QByteArray &out) const;
+
+private:
+    struct Token {
+        enum Kind : quint8 {
+            Text,
+            BeginColors,
+            EndColors,
+            Name,
+            Ident,
+            Hex,
+            Rgb,
+            Comma,
+            NamedHex,
+            NamedRgb,
+        };
+
+        Kind kind;
+        // literal text, or the color name for NamedHex and NamedRgb
+        QByteArray text;
+        // for BeginColors, index of the matching EndColors
+        qsizetype end = -1;
+    };
+
+    void appendText(QByteArrayView text, bool inLoop);
+    void fail(const QString &message);
+    static void renderToken(const Token &token, const Palette &palette, const Palette::Entry *entry, bool last, QByteArray &out);
+
+    QList<Token> tokens;
+    // bytes rendered once, and bytes rendered per color, used to size the output buffer up front
+    qsizetype fixedSize = 0;
+    qsizetype perColorSize = 0;
+    QString error;
+    QByteArray sourceChecksum;
+};
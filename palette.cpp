@@ -0,0 +1,756 @@
+#include "palette.h"
+#include "shadeRamp.h"
+
+#include <KColorUtils>
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+using namespace Qt::Literals::StringLiterals;
+
+namespace
+{
+using KCS = KColorScheme;
+
+// where a variable takes its color from
+struct ColorSource {
+    enum Kind : quint8 {
+        None,
+        Foreground,
+        Background,
+        Decoration,
+        // mix of the normal background and foreground, like breeze does for frames
+        Border,
+        // an entry of the [WM] group in kdeglobals
+        WindowManager,
+    };
+
+    Kind kind = None;
+    QPalette::ColorGroup state = QPalette::Active;
+    KCS::ColorSet set = KCS::View;
+    int role = 0;
+    const char *windowManagerKey = nullptr;
+};
+
+struct ColorVariable {
+    QLatin1StringView name;
+    ColorSource source;
+    // used instead of source if the scheme has no Header color set
+    ColorSource headerlessSource = {};
+};
+
+constexpr ColorSource fg(QPalette::ColorGroup state, KCS::ColorSet set, KCS::ForegroundRole role = KCS::NormalText)
+{
+    return {ColorSource::Foreground, state, set, role};
+}
+
+constexpr ColorSource bg(QPalette::ColorGroup state, KCS::ColorSet set, KCS::BackgroundRole role = KCS::NormalBackground)
+{
+    return {ColorSource::Background, state, set, role};
+}
+
+constexpr ColorSource deco(QPalette::ColorGroup state, KCS::ColorSet set, KCS::DecorationRole role)
+{
+    return {ColorSource::Decoration, state, set, role};
+}
+
+constexpr ColorSource border(QPalette::ColorGroup state, KCS::ColorSet set)
+{
+    return {ColorSource::Border, state, set};
+}
+
+constexpr ColorSource wm(const char *key)
+{
+    return {ColorSource::WindowManager, QPalette::Active, KCS::View, 0, key};
+}
+
+constexpr PaletteInputs inputsOf(const ColorSource &source)
+{
+    switch (source.kind) {
+    case ColorSource::None:
+        return 0;
+    case ColorSource::WindowManager:
+        return WindowManagerInput;
+    default:
+        break;
+    }
+
+    PaletteInputs inputs = PaletteInputs(1) << source.set;
+    if (source.state == QPalette::Inactive) {
+        inputs |= InactiveEffectsInput;
+    } else if (source.state == QPalette::Disabled) {
+        inputs |= DisabledEffectsInput;
+    }
+    // KColorScheme puts the accent into the selection colors, the focus and hover
+    // decorations and the active and link text, which the matching backgrounds are
+    // mixed from. Rather too many than too few
+    const bool accentText = source.kind == ColorSource::Foreground
+        && (source.role == KCS::ActiveText || source.role == KCS::LinkText || source.role == KCS::VisitedText);
+    const bool accentBackground = source.kind == ColorSource::Background
+        && (source.role == KCS::ActiveBackground || source.role == KCS::LinkBackground || source.role == KCS::VisitedBackground);
+    if (source.set == KCS::Selection || source.kind == ColorSource::Decoration || accentText || accentBackground) {
+        inputs |= AccentColorInput;
+    }
+    return inputs;
+}
+
+constexpr PaletteInputs inputsOf(const ColorVariable &variable)
+{
+    if (variable.headerlessSource.kind == ColorSource::None) {
+        return inputsOf(variable.source);
+    }
+    // which of the two is used depends on whether there's a [Colors:Header]
+    return inputsOf(variable.source) | inputsOf(variable.headerlessSource) | HeaderColorsInput;
+}
+
+template<std::size_t N>
+constexpr std::array<PaletteInputs, N> makeInputs(const ColorVariable (&variables)[N])
+{
+    std::array<PaletteInputs, N> inputs{};
+    for (std::size_t i = 0; i < N; i++) {
+        inputs[i] = inputsOf(variables[i]);
+    }
+    return inputs;
+}
+
+// copied from https://invent.kde.org/plasma/kde-gtk-config/-/blob/master/kded/configvalueprovider.cpp
+constexpr ColorVariable kdeVariables[] = {
+    {"theme-fg-color-breeze"_L1, fg(QPalette::Active, KCS::Window)},
+    {"theme-bg-color-breeze"_L1, bg(QPalette::Active, KCS::Window)},
+    {"theme-text-color-breeze"_L1, fg(QPalette::Active, KCS::View)},
+    {"theme-base-color-breeze"_L1, bg(QPalette::Active, KCS::View)},
+    {"theme-view-hover-decoration-color-breeze"_L1, deco(QPalette::Active, KCS::View, KCS::HoverColor)},
+    {"theme-hovering-selected-bg-color-breeze"_L1, deco(QPalette::Active, KCS::Selection, KCS::HoverColor)},
+    {"theme-selected-bg-color-breeze"_L1, bg(QPalette::Active, KCS::Selection)},
+    {"theme-selected-fg-color-breeze"_L1, fg(QPalette::Active, KCS::Selection)},
+    {"theme-view-active-decoration-color-breeze"_L1, deco(QPalette::Active, KCS::View, KCS::HoverColor)},
+    {"theme-button-background-normal-breeze"_L1, bg(QPalette::Active, KCS::Button)},
+    {"theme-button-decoration-hover-breeze"_L1, deco(QPalette::Active, KCS::Button, KCS::HoverColor)},
+    {"theme-button-decoration-focus-breeze"_L1, deco(QPalette::Active, KCS::Button, KCS::FocusColor)},
+    {"theme-button-foreground-normal-breeze"_L1, fg(QPalette::Active, KCS::Button)},
+    {"theme-button-foreground-active-breeze"_L1, fg(QPalette::Active, KCS::Selection)},
+    {"borders-breeze"_L1, border(QPalette::Active, KCS::Window)},
+    {"warning-color-breeze"_L1, fg(QPalette::Active, KCS::View, KCS::NeutralText)},
+    {"success-color-breeze"_L1, fg(QPalette::Active, KCS::View, KCS::PositiveText)},
+    {"error-color-breeze"_L1, fg(QPalette::Active, KCS::View, KCS::NegativeText)},
+    {"theme-unfocused-fg-color-breeze"_L1, fg(QPalette::Inactive, KCS::Window)},
+    {"theme-unfocused-text-color-breeze"_L1, fg(QPalette::Inactive, KCS::View)},
+    {"theme-unfocused-bg-color-breeze"_L1, bg(QPalette::Inactive, KCS::Window)},
+    {"theme-unfocused-base-color-breeze"_L1, bg(QPalette::Inactive, KCS::View)},
+    {"theme-unfocused-selected-bg-color-alt-breeze"_L1, bg(QPalette::Inactive, KCS::Selection)},
+    {"theme-unfocused-selected-bg-color-breeze"_L1, bg(QPalette::Inactive, KCS::Selection)},
+    {"theme-unfocused-selected-fg-color-breeze"_L1, fg(QPalette::Inactive, KCS::Selection)},
+    {"theme-button-background-backdrop-breeze"_L1, bg(QPalette::Inactive, KCS::Button)},
+    {"theme-button-decoration-hover-backdrop-breeze"_L1, deco(QPalette::Inactive, KCS::Button, KCS::HoverColor)},
+    {"theme-button-decoration-focus-backdrop-breeze"_L1, deco(QPalette::Inactive, KCS::Button, KCS::FocusColor)},
+    {"theme-button-foreground-backdrop-breeze"_L1, fg(QPalette::Inactive, KCS::Button)},
+    {"theme-button-foreground-active-backdrop-breeze"_L1, fg(QPalette::Inactive, KCS::Selection)},
+    {"unfocused-borders-breeze"_L1, border(QPalette::Inactive, KCS::Window)},
+    {"warning-color-backdrop-breeze"_L1, fg(QPalette::Inactive, KCS::View, KCS::NeutralText)},
+    {"success-color-backdrop-breeze"_L1, fg(QPalette::Inactive, KCS::View, KCS::PositiveText)},
+    {"error-color-backdrop-breeze"_L1, fg(QPalette::Inactive, KCS::View, KCS::NegativeText)},
+    {"insensitive-fg-color-breeze"_L1, fg(QPalette::Disabled, KCS::Window)},
+    {"insensitive-base-fg-color-breeze"_L1, fg(QPalette::Disabled, KCS::View)},
+    {"insensitive-bg-color-breeze"_L1, bg(QPalette::Disabled, KCS::Window)},
+    {"insensitive-base-color-breeze"_L1, bg(QPalette::Disabled, KCS::View)},
+    {"insensitive-selected-bg-color-breeze"_L1, bg(QPalette::Disabled, KCS::Selection)},
+    {"insensitive-selected-fg-color-breeze"_L1, fg(QPalette::Disabled, KCS::Selection)},
+    {"theme-button-background-insensitive-breeze"_L1, bg(QPalette::Disabled, KCS::Button)},
+    {"theme-button-decoration-hover-insensitive-breeze"_L1, deco(QPalette::Disabled, KCS::Button, KCS::HoverColor)},
+    {"theme-button-decoration-focus-insensitive-breeze"_L1, deco(QPalette::Disabled, KCS::Button, KCS::FocusColor)},
+    {"theme-button-foreground-insensitive-breeze"_L1, fg(QPalette::Disabled, KCS::Button)},
+    {"theme-button-foreground-active-insensitive-breeze"_L1, fg(QPalette::Disabled, KCS::Selection)},
+    {"insensitive-borders-breeze"_L1, border(QPalette::Disabled, KCS::Window)},
+    {"warning-color-insensitive-breeze"_L1, fg(QPalette::Disabled, KCS::View, KCS::NeutralText)},
+    {"success-color-insensitive-breeze"_L1, fg(QPalette::Disabled, KCS::View, KCS::PositiveText)},
+    {"error-color-insensitive-breeze"_L1, fg(QPalette::Disabled, KCS::View, KCS::NegativeText)},
+    {"insensitive-unfocused-fg-color-breeze"_L1, fg(QPalette::Disabled, KCS::Window)},
+    {"theme-unfocused-view-text-color-breeze"_L1, fg(QPalette::Disabled, KCS::View)},
+    {"insensitive-unfocused-bg-color-breeze"_L1, bg(QPalette::Disabled, KCS::Window)},
+    {"theme-unfocused-view-bg-color-breeze"_L1, bg(QPalette::Disabled, KCS::View)},
+    {"insensitive-unfocused-selected-bg-color-breeze"_L1, bg(QPalette::Disabled, KCS::Selection)},
+    {"insensitive-unfocused-selected-fg-color-breeze"_L1, fg(QPalette::Disabled, KCS::Selection)},
+    {"theme-button-background-backdrop-insensitive-breeze"_L1, bg(QPalette::Disabled, KCS::Button)},
+    {"theme-button-decoration-hover-backdrop-insensitive-breeze"_L1, deco(QPalette::Disabled, KCS::Button, KCS::HoverColor)},
+    {"theme-button-decoration-focus-backdrop-insensitive-breeze"_L1, deco(QPalette::Disabled, KCS::Button, KCS::FocusColor)},
+    {"theme-button-foreground-backdrop-insensitive-breeze"_L1, fg(QPalette::Disabled, KCS::Button)},
+    {"theme-button-foreground-active-backdrop-insensitive-breeze"_L1, fg(QPalette::Disabled, KCS::Selection)},
+    {"unfocused-insensitive-borders-breeze"_L1, border(QPalette::Disabled, KCS::Window)},
+    {"warning-color-insensitive-backdrop-breeze"_L1, fg(QPalette::Disabled, KCS::View, KCS::NeutralText)},
+    {"success-color-insensitive-backdrop-breeze"_L1, fg(QPalette::Disabled, KCS::View, KCS::PositiveText)},
+    {"error-color-insensitive-backdrop-breeze"_L1, fg(QPalette::Disabled, KCS::View, KCS::NegativeText)},
+    {"link-color-breeze"_L1, fg(QPalette::Active, KCS::View, KCS::LinkText)},
+    {"link-visited-color-breeze"_L1, fg(QPalette::Active, KCS::View, KCS::VisitedText)},
+    {"tooltip-text-breeze"_L1, fg(QPalette::Active, KCS::Tooltip)},
+    {"tooltip-background-breeze"_L1, bg(QPalette::Active, KCS::Tooltip)},
+    {"tooltip-border-breeze"_L1, border(QPalette::Active, KCS::Tooltip)},
+    {"content-view-bg-breeze"_L1, bg(QPalette::Active, KCS::View)},
+
+    // Handle Headers (menu bars and some of toolbars)
+    // If we have a separate Header color set, use it for both titlebar and header coloring,
+    // if we don't we'll use regular window colors for headerbar and WM group for a titlebar
+    {"theme-header-background-breeze"_L1, bg(QPalette::Active, KCS::Header), bg(QPalette::Active, KCS::Window)},
+    {"theme-header-foreground-breeze"_L1, fg(QPalette::Active, KCS::Header), fg(QPalette::Active, KCS::Window)},
+    {"theme-header-background-light-breeze"_L1, bg(QPalette::Active, KCS::Window)},
+    {"theme-header-foreground-backdrop-breeze"_L1, fg(QPalette::Inactive, KCS::Header), fg(QPalette::Inactive, KCS::Window)},
+    {"theme-header-background-backdrop-breeze"_L1, bg(QPalette::Inactive, KCS::Header), bg(QPalette::Inactive, KCS::Window)},
+    {"theme-header-foreground-insensitive-breeze"_L1, fg(QPalette::Inactive, KCS::Header), fg(QPalette::Inactive, KCS::Window)},
+    {"theme-header-foreground-insensitive-backdrop-breeze"_L1, fg(QPalette::Inactive, KCS::Header), fg(QPalette::Inactive, KCS::Window)},
+    {"theme-titlebar-background-breeze"_L1, bg(QPalette::Active, KCS::Header), wm("activeBackground")},
+    {"theme-titlebar-foreground-breeze"_L1, fg(QPalette::Active, KCS::Header), wm("activeForeground")},
+    {"theme-titlebar-background-light-breeze"_L1, bg(QPalette::Active, KCS::Window)},
+    {"theme-titlebar-foreground-backdrop-breeze"_L1, fg(QPalette::Inactive, KCS::Header), wm("inactiveForeground")},
+    {"theme-titlebar-background-backdrop-breeze"_L1, bg(QPalette::Inactive, KCS::Header), wm("inactiveBackground")},
+    {"theme-titlebar-foreground-insensitive-breeze"_L1, fg(QPalette::Inactive, KCS::Header), wm("inactiveForeground")},
+    {"theme-titlebar-foreground-insensitive-backdrop-breeze"_L1, fg(QPalette::Inactive, KCS::Header), wm("inactiveForeground")},
+};
+
+constexpr ColorVariable discordVariables[] = {
+    {"background-primary"_L1, bg(QPalette::Active, KCS::Window, KCS::AlternateBackground)},
+    {"background-secondary"_L1, bg(QPalette::Active, KCS::View)},
+    {"modal-footer-background"_L1, bg(QPalette::Active, KCS::Window)},
+    {"background-secondary-alt"_L1, bg(QPalette::Active, KCS::View)},
+    {"background-tertiary"_L1, bg(QPalette::Active, KCS::View, KCS::AlternateBackground)},
+    {"background-accent"_L1, bg(QPalette::Active, KCS::Window)},
+    {"background-floating"_L1, bg(QPalette::Active, KCS::Window)},
+    {"background-modifier-selected"_L1, bg(QPalette::Active, KCS::Window, KCS::ActiveBackground)},
+    {"background-modifier-hover"_L1, bg(QPalette::Active, KCS::Window, KCS::ActiveBackground)},
+    {"background-modifier-active"_L1, bg(QPalette::Active, KCS::Window, KCS::ActiveBackground)},
+    {"modal-background"_L1, bg(QPalette::Active, KCS::Window)},
+    {"home-background"_L1, bg(QPalette::Active, KCS::Window, KCS::AlternateBackground)},
+    {"scrollbar-thin-thumb"_L1, bg(QPalette::Active, KCS::Selection)},
+    {"scrollbar-auto-thumb"_L1, bg(QPalette::Active, KCS::Selection)},
+    {"scrollbar-auto-track"_L1, bg(QPalette::Active, KCS::Window)},
+    {"scrollbar-auto-scrollbar-color-thumb"_L1, bg(QPalette::Active, KCS::Selection)},
+    {"scrollbar-auto-scrollbar-color-track"_L1, bg(QPalette::Active, KCS::Window)},
+    {"channeltextarea-background"_L1, bg(QPalette::Active, KCS::View)},
+    {"input-background"_L1, bg(QPalette::Active, KCS::View)},
+    {"background-nested-floating"_L1, bg(QPalette::Active, KCS::View, KCS::AlternateBackground)},
+};
+
+// keys of the [General] group, one that isn't listed might be a color setting
+struct GeneralKey {
+    const char *name;
+    PaletteInputs inputs;
+};
+
+constexpr GeneralKey generalKeys[] = {
+    // a whole new scheme, usually along with all of its groups
+    {"ColorScheme", AllPaletteInputs},
+    {"ColorSchemeHash", AllPaletteInputs},
+    // how much the colors are tinted with the accent
+    {"TintFactor", AllPaletteInputs},
+    {"AccentColor", AccentColorInput},
+    {"accentColorFromWallpaper", AccentColorInput},
+    // the titlebars are the header or [WM] colors, these tint them with the accent
+    {"accentActiveTitlebar", AccentColorInput | HeaderColorsInput | WindowManagerInput},
+    {"accentInactiveTitlebar", AccentColorInput | HeaderColorsInput | WindowManagerInput},
+    // only remembered by the color settings
+    {"LastUsedCustomAccentColor", 0},
+    // fonts, default apps and the widget style
+    {"font", 0},
+    {"fixed", 0},
+    {"smallestReadableFont", 0},
+    {"toolBarFont", 0},
+    {"menuFont", 0},
+    {"desktopFont", 0},
+    {"taskbarFont", 0},
+    {"activeFont", 0},
+    {"widgetStyle", 0},
+    {"BrowserApplication", 0},
+    {"TerminalApplication", 0},
+    {"TerminalService", 0},
+    {"XftAntialias", 0},
+    {"XftHintStyle", 0},
+    {"XftSubPixel", 0},
+};
+
+constexpr auto kdeVariableInputs = makeInputs(kdeVariables);
+constexpr auto discordVariableInputs = makeInputs(discordVariables);
+
+// the colors the discord ramps are made from
+constexpr ColorSource brandSource = bg(QPalette::Active, KCS::Selection);
+constexpr ColorSource primarySource = bg(QPalette::Active, KCS::View, KCS::AlternateBackground);
+
+constexpr int discordRampStops[] = {
+    100, 130, 160, 200, 230, 260, 300, 330, 345, 360, 400, 430, 460, 500, 530, 560, 600, 630, 645, 660, 700, 730, 760, 800, 830, 860, 900,
+};
+
+// colors of the ramps palette, RampSettings picks which ones get which of rampStopChoices
+struct RampRole {
+    const char *prefix;
+    ColorSource source;
+};
+
+constexpr RampRole rampRoles[] = {
+    {"accent-", bg(QPalette::Active, KCS::Selection)},
+    {"window-", bg(QPalette::Active, KCS::Window)},
+    {"view-", bg(QPalette::Active, KCS::View)},
+    {"text-", fg(QPalette::Active, KCS::View)},
+    {"active-", fg(QPalette::Active, KCS::View, KCS::ActiveText)},
+    {"link-", fg(QPalette::Active, KCS::View, KCS::LinkText)},
+    {"visited-", fg(QPalette::Active, KCS::View, KCS::VisitedText)},
+    {"positive-", fg(QPalette::Active, KCS::View, KCS::PositiveText)},
+    {"neutral-", fg(QPalette::Active, KCS::View, KCS::NeutralText)},
+    {"negative-", fg(QPalette::Active, KCS::View, KCS::NegativeText)},
+};
+static_assert(std::size(rampRoles) == RampSettings::RoleCount);
+
+// every stop RampSettings can have, 50 is almost white, 950 almost black
+constexpr int rampStopChoices[] = {50, 100, 150, 200, 250, 300, 350, 400, 450, 500, 550, 600, 650, 700, 750, 800, 850, 900, 950};
+static_assert(std::size(rampStopChoices) == RampSettings::MaxStops && rampStopChoices[0] == RampSettings::StopStep);
+static_assert(RampSettings::RoleCount * RampSettings::MaxStops <= Palette::Capacity);
+
+using RampName = std::array<char, 16>;
+
+// "brand-100", "accent-50"... generated at compile time so the palette can point at them
+constexpr RampName makeRampName(const char *prefix, int stop)
+{
+    RampName name{};
+    std::size_t pos = 0;
+    for (; prefix[pos] != '\0'; pos++) {
+        name[pos] = prefix[pos];
+    }
+    for (int divisor = stop >= 100 ? 100 : 10; divisor > 0; divisor /= 10) {
+        name[pos++] = char('0' + stop / divisor % 10);
+    }
+    return name;
+}
+
+template<std::size_t S>
+constexpr std::array<RampName, S> makeRampNames(const char *prefix, const int (&stops)[S])
+{
+    std::array<RampName, S> names{};
+    for (std::size_t i = 0; i < S; i++) {
+        names[i] = makeRampName(prefix, stops[i]);
+    }
+    return names;
+}
+
+template<std::size_t R, std::size_t S>
+constexpr std::array<std::array<RampName, S>, R> makeRampNames(const RampRole (&roles)[R], const int (&stops)[S])
+{
+    std::array<std::array<RampName, S>, R> names{};
+    for (std::size_t i = 0; i < R; i++) {
+        names[i] = makeRampNames(roles[i].prefix, stops);
+    }
+    return names;
+}
+
+constexpr auto brandNames = makeRampNames("brand-", discordRampStops);
+constexpr auto primaryNames = makeRampNames("primary-", discordRampStops);
+constexpr auto semanticRampNames = makeRampNames(rampRoles, rampStopChoices);
+
+// lightness of each stop, in the space of the ramp
+template<std::size_t S>
+constexpr std::array<float, S> makeRampLightness(const int (&stops)[S])
+{
+    std::array<float, S> lightness{};
+    for (std::size_t i = 0; i < S; i++) {
+        lightness[i] = 1.f - 0.85f * float(stops[i]) / 1000.f;
+    }
+    return lightness;
+}
+
+constexpr auto semanticRampLightness = makeRampLightness(rampStopChoices);
+
+// where a stop is in rampStopChoices, and so in semanticRampNames and semanticRampLightness
+std::size_t rampStopIndex(int stop)
+{
+    Q_ASSERT(stop % RampSettings::StopStep == 0 && stop >= RampSettings::StopStep && stop / RampSettings::StopStep <= RampSettings::MaxStops);
+    return std::size_t(stop / RampSettings::StopStep - 1);
+}
+
+QLatin1StringView rampColorName(std::size_t role, int stop)
+{
+    return QLatin1StringView(semanticRampNames[role][rampStopIndex(stop)].data());
+}
+
+bool hasRampRole(const RampSettings &ramps, std::size_t role)
+{
+    return ramps.roles & (quint32(1) << role);
+}
+
+template<std::size_t... I>
+std::array<KCS, sizeof...(I)> makeSchemes(const KSharedConfigPtr &config, std::index_sequence<I...>)
+{
+    return {KCS(QPalette::ColorGroup(I / KCS::NColorSets), KCS::ColorSet(I % KCS::NColorSets), config)...};
+}
+
+QColor resolve(const ColorSchemeSet &schemes, const ColorSource &source)
+{
+    switch (source.kind) {
+    case ColorSource::Foreground:
+        return schemes.scheme(source.state, source.set).foreground(KCS::ForegroundRole(source.role)).color();
+    case ColorSource::Background:
+        return schemes.scheme(source.state, source.set).background(KCS::BackgroundRole(source.role)).color();
+    case ColorSource::Decoration:
+        return schemes.scheme(source.state, source.set).decoration(KCS::DecorationRole(source.role)).color();
+    case ColorSource::Border: {
+        const KCS &scheme = schemes.scheme(source.state, source.set);
+        return KColorUtils::mix(scheme.background(KCS::NormalBackground).color(), scheme.foreground(KCS::NormalText).color(), 0.25);
+    }
+    case ColorSource::WindowManager:
+        return schemes.windowManagerColor(source.windowManagerKey);
+    case ColorSource::None:
+        break;
+    }
+    return QColor();
+}
+
+QColor resolve(const ColorSchemeSet &schemes, const ColorVariable &variable)
+{
+    const bool useHeaderless = !schemes.hasHeaderColors() && variable.headerlessSource.kind != ColorSource::None;
+    return resolve(schemes, useHeaderless ? variable.headerlessSource : variable.source);
+}
+
+template<std::size_t N>
+void appendVariables(Palette &palette, const ColorSchemeSet &schemes, const ColorVariable (&variables)[N])
+{
+    for (const ColorVariable &variable : variables) {
+        palette.append(variable.name, resolve(schemes, variable));
+    }
+}
+
+template<std::size_t N>
+int updateVariables(Palette &palette,
+                    const ColorSchemeSet &schemes,
+                    const ColorVariable (&variables)[N],
+                    const std::array<PaletteInputs, N> &inputs,
+                    PaletteInputs changed)
+{
+    int count = 0;
+    for (std::size_t i = 0; i < N; i++) {
+        if (inputs[i] & changed) {
+            palette.set(variables[i].name, resolve(schemes, variables[i]));
+            count++;
+        }
+    }
+    return count;
+}
+
+constexpr std::size_t discordStopCount = std::size(discordRampStops);
+using DiscordRamp = std::array<QRgb, discordStopCount>;
+
+// the css variables go from almost white (eg. --brand-100) to almost black (--brand-900).
+// the lightness is rounded to 8 bit like it was when these went through QColor::fromHsl()
+const std::array<std::array<float, discordStopCount>, 2> &discordRampLightness()
+{
+    static const auto lightness = []() {
+        // i love magic
+        auto superCoolEasingFunction = [](float x) {
+            return x < 0.5 ? std::pow(1.3, 20 * x - 10) / 2 : (2 - std::pow(1.3, -20 * x + 10)) / 2;
+        };
+
+        std::array<std::array<float, discordStopCount>, 2> lightness;
+        for (std::size_t i = 0; i < discordStopCount; i++) {
+            const float t = discordRampStops[i] / 900.f;
+            lightness[0][i] = int(std::abs((t * 255) - 255)) / 255.f;
+            lightness[1][i] = int(std::abs((superCoolEasingFunction(t) * 255) - 255)) / 255.f;
+        }
+        return lightness;
+    }();
+    return lightness;
+}
+
+void generateBrandRamp(const ColorSchemeSet &schemes, DiscordRamp &shades)
+{
+    ShadeRamp(ShadeRamp::Hsl, resolve(schemes, brandSource)).generate(discordRampLightness()[0], shades);
+}
+
+void generatePrimaryRamp(const ColorSchemeSet &schemes, DiscordRamp &shades)
+{
+    ShadeRamp(ShadeRamp::Hsl, resolve(schemes, primarySource)).generate(discordRampLightness()[1], shades);
+}
+
+using SemanticRamp = std::array<QRgb, RampSettings::MaxStops>;
+
+// the first ramps.stopCount of shades
+void generateSemanticRamp(const ColorSchemeSet &schemes, const RampSettings &ramps, std::size_t role, SemanticRamp &shades)
+{
+    std::array<float, RampSettings::MaxStops> lightness;
+    for (qsizetype i = 0; i < ramps.stopCount; i++) {
+        lightness[i] = semanticRampLightness[rampStopIndex(ramps.stops[i])];
+    }
+    ShadeRamp(ramps.space, resolve(schemes, rampRoles[role].source)).generate(std::span(lightness.data(), ramps.stopCount), shades);
+}
+}
+
+void Palette::append(QLatin1StringView name, const QColor &color)
+{
+    Q_ASSERT(count < Capacity);
+    entries[count++] = {name, color};
+}
+
+void Palette::sort()
+{
+    std::sort(entries.begin(), entries.begin() + count, [](const Entry &a, const Entry &b) {
+        return a.name < b.name;
+    });
+}
+
+bool Palette::set(QLatin1StringView name, const QColor &color)
+{
+    for (qsizetype i = 0; i < count; i++) {
+        if (entries[i].name == name) {
+            entries[i].color = color;
+            return true;
+        }
+    }
+    return false;
+}
+
+const QColor *Palette::find(QLatin1StringView name) const
+{
+    for (const Entry &entry : *this) {
+        if (entry.name == name) {
+            return &entry.color;
+        }
+    }
+    return nullptr;
+}
+
+bool Palette::operator==(const Palette &other) const
+{
+    return std::equal(begin(), end(), other.begin(), other.end(), [](const Entry &a, const Entry &b) {
+        return a.name == b.name && a.color == b.color;
+    });
+}
+
+ColorSchemeSet::ColorSchemeSet(const KSharedConfigPtr &config)
+    : schemes(makeSchemes(config, std::make_index_sequence<StateCount * KCS::NColorSets>()))
+    , windowManagerConfig(config, QStringLiteral("WM"))
+    , headerColors(KCS::isColorSetSupported(config, KCS::Header))
+{
+}
+
+const KColorScheme &ColorSchemeSet::scheme(QPalette::ColorGroup state, KColorScheme::ColorSet set) const
+{
+    Q_ASSERT(state < StateCount && set < KCS::NColorSets);
+    return schemes[state * KCS::NColorSets + set];
+}
+
+QColor ColorSchemeSet::windowManagerColor(const char *key) const
+{
+    return windowManagerConfig.readEntry(key, QColor());
+}
+
+bool ColorSchemeSet::hasHeaderColors() const
+{
+    return headerColors;
+}
+
+Palette computeKdePalette(const ColorSchemeSet &schemes)
+{
+    Palette palette;
+    appendVariables(palette, schemes, kdeVariables);
+    palette.sort();
+    return palette;
+}
+
+Palette computeDiscordPalette(const ColorSchemeSet &schemes)
+{
+    Palette palette;
+    appendVariables(palette, schemes, discordVariables);
+
+    DiscordRamp brand;
+    DiscordRamp primaryShades;
+    generateBrandRamp(schemes, brand);
+    generatePrimaryRamp(schemes, primaryShades);
+
+    for (std::size_t i = 0; i < discordStopCount; i++) {
+        palette.append(QLatin1StringView(brandNames[i].data()), QColor::fromRgb(brand[i]));
+        palette.append(QLatin1StringView(primaryNames[i].data()), QColor::fromRgb(primaryShades[i]));
+    }
+
+    palette.sort();
+    return palette;
+}
+
+Palette computeRampPalette(const ColorSchemeSet &schemes, const RampSettings &ramps)
+{
+    Palette palette;
+    SemanticRamp shades;
+
+    for (std::size_t role = 0; role < std::size(rampRoles); role++) {
+        if (!hasRampRole(ramps, role)) {
+            continue;
+        }
+        generateSemanticRamp(schemes, ramps, role, shades);
+        for (qsizetype i = 0; i < ramps.stopCount; i++) {
+            palette.append(rampColorName(role, ramps.stops[i]), QColor::fromRgb(shades[i]));
+        }
+    }
+
+    palette.sort();
+    return palette;
+}
+
+QLatin1StringView rampRoleName(int role)
+{
+    Q_ASSERT(role >= 0 && role < RampSettings::RoleCount);
+    // without the dash
+    return QLatin1StringView(rampRoles[role].prefix).chopped(1);
+}
+
+Palette computePalette(PaletteId id, const ColorSchemeSet &schemes, const RampSettings &ramps)
+{
+    switch (id) {
+    case KdePalette:
+        return computeKdePalette(schemes);
+    case DiscordPalette:
+        return computeDiscordPalette(schemes);
+    case RampPalette:
+        return computeRampPalette(schemes, ramps);
+    case PaletteCount:
+        break;
+    }
+    return Palette();
+}
+
+bool paletteHasColor(PaletteId id, QLatin1StringView name, const RampSettings &ramps)
+{
+    const auto isVariable = [name](const ColorVariable &variable) {
+        return variable.name == name;
+    };
+    const auto isRampName = [name](const RampName &rampName) {
+        return QLatin1StringView(rampName.data()) == name;
+    };
+
+    switch (id) {
+    case KdePalette:
+        return std::any_of(std::begin(kdeVariables), std::end(kdeVariables), isVariable);
+    case DiscordPalette:
+        return std::any_of(std::begin(discordVariables), std::end(discordVariables), isVariable)
+            || std::any_of(brandNames.cbegin(), brandNames.cend(), isRampName) || std::any_of(primaryNames.cbegin(), primaryNames.cend(), isRampName);
+    case RampPalette:
+        for (std::size_t role = 0; role < std::size(rampRoles); role++) {
+            if (!hasRampRole(ramps, role)) {
+                continue;
+            }
+            for (qsizetype i = 0; i < ramps.stopCount; i++) {
+                if (rampColorName(role, ramps.stops[i]) == name) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    case PaletteCount:
+        break;
+    }
+    return false;
+}
+
+int updatePalette(PaletteId id, const ColorSchemeSet &schemes, const RampSettings &ramps, PaletteInputs changed, Palette &palette)
+{
+    if (palette.size() == 0) {
+        palette = computePalette(id, schemes, ramps);
+        return int(palette.size());
+    }
+
+    switch (id) {
+    case KdePalette:
+        return updateVariables(palette, schemes, kdeVariables, kdeVariableInputs, changed);
+    case DiscordPalette: {
+        int count = updateVariables(palette, schemes, discordVariables, discordVariableInputs, changed);
+        DiscordRamp shades;
+        if (inputsOf(brandSource) & changed) {
+            generateBrandRamp(schemes, shades);
+            for (std::size_t i = 0; i < discordStopCount; i++) {
+                palette.set(QLatin1StringView(brandNames[i].data()), QColor::fromRgb(shades[i]));
+            }
+            count += int(discordStopCount);
+        }
+        if (inputsOf(primarySource) & changed) {
+            generatePrimaryRamp(schemes, shades);
+            for (std::size_t i = 0; i < discordStopCount; i++) {
+                palette.set(QLatin1StringView(primaryNames[i].data()), QColor::fromRgb(shades[i]));
+            }
+            count += int(discordStopCount);
+        }
+        return count;
+    }
+    case RampPalette: {
+        int count = 0;
+        SemanticRamp shades;
+        for (std::size_t role = 0; role < std::size(rampRoles); role++) {
+            if (!hasRampRole(ramps, role) || !(inputsOf(rampRoles[role].source) & changed)) {
+                continue;
+            }
+            generateSemanticRamp(schemes, ramps, role, shades);
+            for (qsizetype i = 0; i < ramps.stopCount; i++) {
+                palette.set(rampColorName(role, ramps.stops[i]), QColor::fromRgb(shades[i]));
+            }
+            count += int(ramps.stopCount);
+        }
+        return count;
+    }
+    case PaletteCount:
+        break;
+    }
+    return 0;
+}
+
+PaletteInputs paletteInputsOf(const QString &group, const QByteArrayList &keys)
+{
+    if (group == QStringLiteral("General")) {
+        PaletteInputs inputs = 0;
+        for (const QByteArray &key : keys) {
+            const auto it = std::find_if(std::begin(generalKeys), std::end(generalKeys), [&key](const GeneralKey &generalKey) {
+                return key == generalKey.name;
+            });
+            inputs |= it != std::end(generalKeys) ? it->inputs : AllPaletteInputs;
+        }
+        return inputs;
+    }
+    if (group == QStringLiteral("WM")) {
+        return WindowManagerInput;
+    }
+    if (group == QStringLiteral("ColorEffects:Inactive")) {
+        return InactiveEffectsInput;
+    }
+    if (group == QStringLiteral("ColorEffects:Disabled")) {
+        return DisabledEffectsInput;
+    }
+    if (group.startsWith(QStringLiteral("ColorEffects:"))) {
+        return AllPaletteInputs;
+    }
+    if (group.startsWith(QStringLiteral("Colors:"))) {
+        // same order as KColorScheme::ColorSet
+        static const QString setNames[] = {
+            QStringLiteral("View"),
+            QStringLiteral("Window"),
+            QStringLiteral("Button"),
+            QStringLiteral("Selection"),
+            QStringLiteral("Tooltip"),
+            QStringLiteral("Complementary"),
+            QStringLiteral("Header"),
+        };
+        static_assert(std::size(setNames) == KCS::NColorSets);
+        const QStringView setName = QStringView(group).mid(7);
+        for (int set = 0; set < KCS::NColorSets; set++) {
+            if (setName == setNames[set]) {
+                return PaletteInputs(1) << set;
+            }
+        }
+        return AllPaletteInputs;
+    }
+    return 0;
+}
+
+void appendHexColor(QByteArray &out, const QColor &color)
+{
+    static constexpr char digits[] = "0123456789abcdef";
+    const QRgb rgb = color.rgb();
+    const char hex[7] = {
+        '#',
+        digits[qRed(rgb) >> 4],
+        digits[qRed(rgb) & 0xf],
+        digits[qGreen(rgb) >> 4],
+        digits[qGreen(rgb) & 0xf],
+        digits[qBlue(rgb) >> 4],
+        digits[qBlue(rgb) & 0xf],
+    };
+    out.append(hex, sizeof(hex));
+}
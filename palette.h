@@ -0,0 +1,157 @@
+#pragma once
+
+#include "shadeRamp.h"
+
+#include <QByteArray>
+#include <QByteArrayList>
+#include <QColor>
+#include <QLatin1StringView>
+#include <QPalette>
+
+#include <KColorScheme>
+#include <KConfigGroup>
+#include <KSharedConfig>
+
+#include <algorithm>
+#include <array>
+
+enum PaletteId {
+    // the gtk style variables, exported to kde-colors.css and rofi
+    KdePalette,
+    // the variables used by discord themes, exported to vencord and vesktop
+    DiscordPalette,
+    // shades of the accent, text, link and status colors, accent-50 to accent-950 and so on
+    RampPalette,
+    PaletteCount,
+};
+
+// What the colors are computed from. A change to kdeglobals maps to some of
+// these, and only the colors that depend on one of them are computed again.
+enum PaletteInput : quint32 {
+    // one per KColorScheme::ColorSet, its [Colors:<set>] group and the nested [Inactive] one
+    ViewColorsInput = 1 << KColorScheme::View,
+    WindowColorsInput = 1 << KColorScheme::Window,
+    ButtonColorsInput = 1 << KColorScheme::Button,
+    SelectionColorsInput = 1 << KColorScheme::Selection,
+    TooltipColorsInput = 1 << KColorScheme::Tooltip,
+    ComplementaryColorsInput = 1 << KColorScheme::Complementary,
+    // also whether the scheme has header colors at all
+    HeaderColorsInput = 1 << KColorScheme::Header,
+    // [ColorEffects:Inactive] and [ColorEffects:Disabled], for the colors of those states
+    InactiveEffectsInput = 1 << KColorScheme::NColorSets,
+    DisabledEffectsInput = InactiveEffectsInput << 1,
+    // [WM]
+    WindowManagerInput = InactiveEffectsInput << 2,
+    // AccentColor in [General]
+    AccentColorInput = InactiveEffectsInput << 3,
+    AllPaletteInputs = (AccentColorInput << 1) - 1,
+};
+using PaletteInputs = quint32;
+
+// the inputs a change to these keys of a kdeglobals group touches, 0 if the colors
+// don't depend on them
+PaletteInputs paletteInputsOf(const QString &group, const QByteArrayList &keys);
+
+// Fixed size list of named colors. Names point to static storage, so filling
+// one doesn't allocate.
+class Palette
+{
+public:
+    // enough for every ramp with every stop
+    static constexpr qsizetype Capacity = 192;
+
+    struct Entry {
+        QLatin1StringView name;
+        QColor color;
+    };
+
+    void append(QLatin1StringView name, const QColor &color);
+    // replaces the color of an existing entry, false if there's none with that name
+    bool set(QLatin1StringView name, const QColor &color);
+    // exported files list the colors alphabetically
+    void sort();
+    // nullptr if there's no color with that name
+    const QColor *find(QLatin1StringView name) const;
+
+    bool operator==(const Palette &other) const;
+
+    const Entry *begin() const
+    {
+        return entries.data();
+    }
+    const Entry *end() const
+    {
+        return entries.data() + count;
+    }
+    qsizetype size() const
+    {
+        return count;
+    }
+
+private:
+    std::array<Entry, Capacity> entries;
+    qsizetype count = 0;
+};
+
+// One KColorScheme per color group and color set of a config, built once per
+// export and shared by every palette computed from it.
+class ColorSchemeSet
+{
+public:
+    explicit ColorSchemeSet(const KSharedConfigPtr &config);
+
+    const KColorScheme &scheme(QPalette::ColorGroup state, KColorScheme::ColorSet set) const;
+    QColor windowManagerColor(const char *key) const;
+    bool hasHeaderColors() const;
+
+private:
+    static constexpr int StateCount = 3;
+
+    std::array<KColorScheme, StateCount * KColorScheme::NColorSets> schemes;
+    KConfigGroup windowManagerConfig;
+    bool headerColors;
+};
+
+// What the ramps palette has, the [Ramps] group of kolorexporterrc. The roles are
+// a fixed set and the stops multiples of StopStep, so the names of the colors
+// can still be generated at compile time.
+struct RampSettings {
+    static constexpr int RoleCount = 10;
+    static constexpr int StopStep = 50;
+    // 50 to 950
+    static constexpr qsizetype MaxStops = 19;
+
+    // one bit per role, in the order of rampRoleName()
+    quint32 roles = (1 << RoleCount) - 1;
+    // ascending, only the first stopCount are used
+    std::array<int, MaxStops> stops = {50, 100, 200, 300, 400, 500, 600, 700, 800, 900, 950};
+    qsizetype stopCount = 11;
+    ShadeRamp::Space space = ShadeRamp::Oklch;
+
+    bool operator==(const RampSettings &other) const
+    {
+        return roles == other.roles && space == other.space && stopCount == other.stopCount
+            && std::equal(stops.cbegin(), stops.cbegin() + stopCount, other.stops.cbegin());
+    }
+};
+
+// "accent", "window", "view", "text", "active", "link", "visited", "positive",
+// "neutral" and "negative", the prefixes of the ramp colors without the dash
+QLatin1StringView rampRoleName(int role);
+
+// the gtk style variables, exported to kde-colors.css and rofi
+Palette computeKdePalette(const ColorSchemeSet &schemes);
+// the variables used by discord themes, exported to vencord and vesktop
+Palette computeDiscordPalette(const ColorSchemeSet &schemes);
+// shades of the semantic colors, not exported by default
+Palette computeRampPalette(const ColorSchemeSet &schemes, const RampSettings &ramps);
+// ramps is only used by RampPalette
+Palette computePalette(PaletteId id, const ColorSchemeSet &schemes, const RampSettings &ramps);
+// whether palette id has a color with this name, without computing it
+bool paletteHasColor(PaletteId id, QLatin1StringView name, const RampSettings &ramps);
+// computes again only the colors of palette that depend on one of changed, or the
+// whole palette if it's empty. Returns how many colors were computed
+int updatePalette(PaletteId id, const ColorSchemeSet &schemes, const RampSettings &ramps, PaletteInputs changed, Palette &palette);
+
+// appends #rrggbb, same as QColor::name() without going through a QString
+void appendHexColor(QByteArray &out, const QColor &color);
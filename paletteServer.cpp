@@ -0,0 +1,254 @@
+#include "paletteServer.h"
+#include "kolorExporterDebug.h"
+
+#include <QLocalSocket>
+#include <QStandardPaths>
+
+using namespace Qt::Literals::StringLiterals;
+
+namespace
+{
+// a live server accepts right away, a stale socket refuses right away
+constexpr int probeTimeout = 500;
+
+constexpr std::array<QLatin1StringView, PaletteCount> paletteNames = {"kde"_L1, "discord"_L1, "ramps"_L1};
+
+// the names are plain identifiers, nothing in them needs escaping
+void appendString(QByteArray &out, QLatin1StringView string)
+{
+    out.append('"');
+    out.append(string);
+    out.append('"');
+}
+
+void appendHeader(QByteArray &out, const char *type, quint64 version)
+{
+    out.append("{\"type\":\"");
+    out.append(type);
+    out.append("\",\"version\":");
+    out.append(QByteArray::number(version));
+}
+}
+
+PaletteServer::PaletteServer(QObject *parent)
+    : QObject(parent)
+{
+    server.setSocketOptions(QLocalServer::UserAccessOption);
+    connect(&server, &QLocalServer::newConnection, this, &PaletteServer::onNewConnection);
+}
+
+QString PaletteServer::defaultSocketName()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation) + QStringLiteral("/kolor-exporter");
+}
+
+bool PaletteServer::listen(const QString &name)
+{
+    // only a socket nobody listens on anymore gets replaced, not the one of another
+    // running instance, e.g. a second kded
+    QLocalSocket probe;
+    probe.connectToServer(name);
+    if (probe.waitForConnected(probeTimeout)) {
+        qCWarning(KOLOR_EXPORTER) << "Something is already listening on" << name << ", not publishing palettes";
+        return false;
+    }
+
+    QLocalServer::removeServer(name);
+    if (!server.listen(name)) {
+        qCWarning(KOLOR_EXPORTER) << "Can't listen on" << name << server.errorString();
+        return false;
+    }
+    return true;
+}
+
+QString PaletteServer::fullServerName() const
+{
+    return server.fullServerName();
+}
+
+void PaletteServer::publish(const std::array<Palette, PaletteCount> &palettes)
+{
+    QByteArray message;
+    if (!published) {
+        // nobody has seen anything yet, including the subscribers waiting for it
+        lastPalettes = palettes;
+        published = true;
+        currentVersion++;
+        snapshot.clear();
+        message = currentSnapshot();
+    } else {
+        message = encodeUpdate(palettes);
+        if (message.isEmpty()) {
+            return;
+        }
+        lastPalettes = palettes;
+        snapshot.clear();
+    }
+
+    // a copy of the list, send() can drop subscribers
+    const QList<QLocalSocket *> sockets = subscribers;
+    for (QLocalSocket *socket : sockets) {
+        send(socket, message);
+    }
+}
+
+quint64 PaletteServer::version() const
+{
+    return currentVersion;
+}
+
+qsizetype PaletteServer::subscriberCount() const
+{
+    return subscribers.size();
+}
+
+quint64 PaletteServer::droppedSubscriberCount() const
+{
+    return droppedSubscribers;
+}
+
+void PaletteServer::onNewConnection()
+{
+    while (QLocalSocket *socket = server.nextPendingConnection()) {
+        subscribers.append(socket);
+        connect(socket, &QLocalSocket::disconnected, this, [this, socket]() {
+            subscribers.removeOne(socket);
+            socket->deleteLater();
+        });
+        // subscribers have nothing to say, don't let them fill the read buffer
+        connect(socket, &QLocalSocket::readyRead, socket, [socket]() {
+            socket->skip(socket->bytesAvailable());
+        });
+
+        if (published) {
+            send(socket, currentSnapshot());
+        } else {
+            Q_EMIT palettesNeeded();
+        }
+    }
+}
+
+void PaletteServer::send(QLocalSocket *socket, const QByteArray &message)
+{
+    // everything queued for it is older than what's sent now, so it gets a
+    // fresh snapshot when it reconnects instead of a growing backlog
+    if (socket->bytesToWrite() + message.size() > MaxPendingBytes) {
+        qCWarning(KOLOR_EXPORTER) << "Dropping a palette subscriber that stopped reading";
+        droppedSubscribers++;
+        subscribers.removeOne(socket);
+        socket->abort();
+        socket->deleteLater();
+        return;
+    }
+    socket->write(message);
+}
+
+const QByteArray &PaletteServer::currentSnapshot()
+{
+    if (!snapshot.isEmpty()) {
+        return snapshot;
+    }
+
+    appendHeader(snapshot, "snapshot", currentVersion);
+    snapshot.append(",\"palettes\":{");
+    for (int id = 0; id < PaletteCount; id++) {
+        if (id > 0) {
+            snapshot.append(',');
+        }
+        appendString(snapshot, paletteNames[id]);
+        snapshot.append(":{");
+        bool first = true;
+        for (const Palette::Entry &entry : lastPalettes[id]) {
+            if (!first) {
+                snapshot.append(',');
+            }
+            first = false;
+            appendString(snapshot, entry.name);
+            snapshot.append(':');
+            snapshot.append('"');
+            appendHexColor(snapshot, entry.color);
+            snapshot.append('"');
+        }
+        snapshot.append('}');
+    }
+    snapshot.append("}}\n");
+    return snapshot;
+}
+
+QByteArray PaletteServer::encodeUpdate(const std::array<Palette, PaletteCount> &palettes)
+{
+    QByteArray changed;
+    QByteArray removed;
+    for (int id = 0; id < PaletteCount; id++) {
+        const Palette &previous = lastPalettes[id];
+        const Palette &current = palettes[id];
+        qsizetype changedCount = 0;
+        qsizetype removedCount = 0;
+
+        // palettes are sorted and almost always have the same names, so the
+        // entry at the same index is checked before searching
+        for (qsizetype i = 0; i < current.size(); i++) {
+            const Palette::Entry &entry = current.begin()[i];
+            const QColor *old = i < previous.size() && previous.begin()[i].name == entry.name ? &previous.begin()[i].color : previous.find(entry.name);
+            if (old && old->rgb() == entry.color.rgb()) {
+                continue;
+            }
+            if (changedCount == 0) {
+                if (!changed.isEmpty()) {
+                    changed.append(',');
+                }
+                appendString(changed, paletteNames[id]);
+                changed.append(":{");
+            } else {
+                changed.append(',');
+            }
+            appendString(changed, entry.name);
+            changed.append(':');
+            changed.append('"');
+            appendHexColor(changed, entry.color);
+            changed.append('"');
+            changedCount++;
+        }
+        if (changedCount > 0) {
+            changed.append('}');
+        }
+
+        for (qsizetype i = 0; i < previous.size(); i++) {
+            const Palette::Entry &entry = previous.begin()[i];
+            if ((i < current.size() && current.begin()[i].name == entry.name) || current.find(entry.name)) {
+                continue;
+            }
+            if (removedCount == 0) {
+                if (!removed.isEmpty()) {
+                    removed.append(',');
+                }
+                appendString(removed, paletteNames[id]);
+                removed.append(":[");
+            } else {
+                removed.append(',');
+            }
+            appendString(removed, entry.name);
+            removedCount++;
+        }
+        if (removedCount > 0) {
+            removed.append(']');
+        }
+    }
+
+    if (changed.isEmpty() && removed.isEmpty()) {
+        return QByteArray();
+    }
+
+    QByteArray message;
+    appendHeader(message, "update", ++currentVersion);
+    message.append(",\"palettes\":{");
+    message.append(changed);
+    message.append('}');
+    if (!removed.isEmpty()) {
+        message.append(",\"removed\":{");
+        message.append(removed);
+        message.append('}');
+    }
+    message.append("}\n");
+    return message;
+}
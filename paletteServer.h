@@ -0,0 +1,73 @@
+#pragma once
+
+#include "palette.h"
+
+#include <QByteArray>
+#include <QList>
+#include <QLocalServer>
+#include <QObject>
+
+#include <array>
+
+class QLocalSocket;
+
+// Pushes the palettes to anything connected to a local socket, so status bars
+// and terminals don't have to watch and re-parse the exported files.
+//
+// Every message is one line of compact JSON. A subscriber first gets
+//   {"type":"snapshot","version":1,"palettes":{"kde":{"name":"#rrggbb",...},"discord":{...},"ramps":{...}}}
+// and then, after every export that changed a color,
+//   {"type":"update","version":2,"palettes":{"kde":{"changed-name":"#rrggbb"}},"removed":{"kde":["name"]}}
+// with only the palettes and colors that changed ("removed" is left out when
+// nothing was). version goes up by one with every message, a subscriber that
+// sees a gap should reconnect to get a new snapshot.
+//
+// Each message is encoded once and queued on every socket, writing never
+// blocks. A subscriber that stops reading is disconnected once it falls
+// MaxPendingBytes behind.
+class PaletteServer : public QObject
+{
+    Q_OBJECT
+public:
+    static constexpr qint64 MaxPendingBytes = 1024 * 1024;
+
+    explicit PaletteServer(QObject *parent = nullptr);
+
+    // $XDG_RUNTIME_DIR/kolor-exporter
+    static QString defaultSocketName();
+
+    // a path, or a name that's placed in the runtime directory. Replaces a socket
+    // left behind by a crashed instance, fails if another one is still listening
+    bool listen(const QString &name);
+    QString fullServerName() const;
+
+    // sends what changed since the last call to every subscriber, nothing if the
+    // palettes are the same
+    void publish(const std::array<Palette, PaletteCount> &palettes);
+
+    // of the last message sent, 0 before the first publish()
+    quint64 version() const;
+    qsizetype subscriberCount() const;
+    // subscribers dropped for not reading
+    quint64 droppedSubscriberCount() const;
+
+Q_SIGNALS:
+    // a subscriber connected before anything was published
+    void palettesNeeded();
+
+private:
+    void onNewConnection();
+    void send(QLocalSocket *socket, const QByteArray &message);
+    const QByteArray &currentSnapshot();
+    // takes the next version, empty if nothing changed
+    QByteArray encodeUpdate(const std::array<Palette, PaletteCount> &palettes);
+
+    QLocalServer server;
+    QList<QLocalSocket *> subscribers;
+    std::array<Palette, PaletteCount> lastPalettes;
+    bool published = false;
+    quint64 currentVersion = 0;
+    // encoded on the first connect after a publish() and reused until the next one
+    QByteArray snapshot;
+    quint64 droppedSubscribers = 0;
+};
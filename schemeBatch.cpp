@@ -0,0 +1,278 @@
+#include "schemeBatch.h"
+#include "exportJob.h"
+#include "kolorExporterDebug.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QSet>
+#include <QStandardPaths>
+
+#include <KConfigGroup>
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+struct SchemeBatch::Batch {
+    SchemeExportSettings settings;
+    // the schemes that changed and their new stamps
+    QStringList schemes;
+    QByteArrayList schemeStamps;
+    // written by the tasks, one entry each
+    std::vector<char> failed;
+    std::atomic<qsizetype> remaining = 0;
+    Result result;
+    QElapsedTimer timer;
+};
+
+namespace
+{
+QString outputBaseName(const SchemeExportSettings &settings, const QString &scheme)
+{
+    return settings.directory + QLatin1Char('/') + QFileInfo(scheme).completeBaseName() + QLatin1Char('.');
+}
+
+// one file per template
+QStringList outputsOf(const SchemeExportSettings &settings, const QString &scheme)
+{
+    const QString baseName = outputBaseName(settings, scheme);
+    QStringList outputs;
+    for (const auto &outputTemplate : settings.templates) {
+        outputs.append(baseName + outputTemplate.first);
+    }
+    return outputs;
+}
+
+bool outputsExist(const QStringList &outputs)
+{
+    return std::all_of(outputs.cbegin(), outputs.cend(), [](const QString &output) {
+        return QFileInfo::exists(output);
+    });
+}
+
+// a scheme's entry in the stamps file is its stamp followed by the files it was exported to,
+// so the ones the next settings don't write anymore can be removed
+QStringList stampEntry(const QByteArray &stamp, const QStringList &outputs)
+{
+    return QStringList{QString::fromLatin1(stamp)} + outputs;
+}
+
+// changes when the scheme file or anything about how it's exported does
+QByteArray stampOf(const QFileInfo &scheme, const SchemeExportSettings &settings)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QByteArray::number(scheme.lastModified().toMSecsSinceEpoch()));
+    hash.addData(QByteArray::number(scheme.size()));
+    hash.addData(settings.directory.toUtf8());
+    hash.addData(QByteArray::number(settings.palette));
+    hash.addData(QByteArray::number(settings.ramps.roles));
+    hash.addData(QByteArray::number(settings.ramps.space));
+    for (qsizetype i = 0; i < settings.ramps.stopCount; i++) {
+        hash.addData(QByteArray::number(settings.ramps.stops[i]) + ',');
+    }
+    for (const auto &[name, outputTemplate] : settings.templates) {
+        hash.addData(name.toUtf8());
+        hash.addData(outputTemplate->checksum());
+    }
+    return hash.result().toHex();
+}
+
+bool exportScheme(const SchemeExportSettings &settings, const QString &fileName)
+{
+    // unlike kdeglobals, which the module shares with the GUI thread, every scheme
+    // gets its own config here, so the KColorSchemes can be built on any thread
+    const KSharedConfigPtr config = KSharedConfig::openConfig(fileName, KConfig::SimpleConfig);
+    const ColorSchemeSet schemes(config);
+    const Palette palette = computePalette(settings.palette, schemes, settings.ramps);
+
+    const QString baseName = outputBaseName(settings, fileName);
+    QByteArray content;
+    bool ok = true;
+    for (const auto &[name, outputTemplate] : settings.templates) {
+        content.resize(0);
+        outputTemplate->render(palette, content);
+        if (ExportJob::writeFileIfChanged(baseName + name, content) == ExportTargetResult::Failed) {
+            ok = false;
+        }
+    }
+    return ok;
+}
+}
+
+SchemeBatch::SchemeBatch(QObject *parent)
+    : SchemeBatch(QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + QStringLiteral("/kolor-exporter/schemes"), parent)
+{
+}
+
+SchemeBatch::SchemeBatch(const QString &stampsFileName, QObject *parent)
+    : QObject(parent)
+    , stamps(KSharedConfig::openConfig(stampsFileName, KConfig::SimpleConfig))
+{
+    // the active scheme comes first, these are only for switching later
+    pool.setThreadPriority(QThread::LowPriority);
+}
+
+SchemeBatch::~SchemeBatch()
+{
+    // while this is still alive, the last task posts finish() to it
+    pool.waitForDone();
+}
+
+QStringList SchemeBatch::schemeDirectories()
+{
+    QStringList directories;
+    const QStringList dataDirectories = QStandardPaths::standardLocations(QStandardPaths::GenericDataLocation);
+    for (const QString &directory : dataDirectories) {
+        directories.append(directory + QStringLiteral("/color-schemes"));
+    }
+    return directories;
+}
+
+QStringList SchemeBatch::findSchemes(const QStringList &directories)
+{
+    QStringList schemes;
+    QSet<QString> fileNames;
+    for (const QString &directory : directories) {
+        const QStringList entries = QDir(directory).entryList({QStringLiteral("*.colors")}, QDir::Files | QDir::Readable, QDir::Name);
+        for (const QString &fileName : entries) {
+            if (!fileNames.contains(fileName)) {
+                fileNames.insert(fileName);
+                schemes.append(directory + QLatin1Char('/') + fileName);
+            }
+        }
+    }
+    return schemes;
+}
+
+void SchemeBatch::start(const SchemeExportSettings &settings, const QStringList &schemes)
+{
+    if (running) {
+        pending = Request{settings, schemes};
+        return;
+    }
+    run(Request{settings, schemes});
+}
+
+bool SchemeBatch::isRunning() const
+{
+    return running;
+}
+
+void SchemeBatch::run(const Request &request)
+{
+    running = true;
+
+    auto batch = std::make_shared<Batch>();
+    batch->timer.start();
+    batch->settings = request.settings;
+
+    if (!QDir().mkpath(request.settings.directory)) {
+        qCWarning(KOLOR_EXPORTER) << "Can't create" << request.settings.directory;
+    }
+
+    KConfigGroup group = stamps->group(QStringLiteral("Stamps"));
+
+    // only stats here, the schemes themselves are read by the tasks
+    QSet<QString> installed;
+    for (const QString &scheme : request.schemes) {
+        installed.insert(scheme);
+
+        const QByteArray stamp = stampOf(QFileInfo(scheme), request.settings);
+        const QStringList entry = group.readEntry(scheme, QStringList());
+        const QStringList outputs = outputsOf(request.settings, scheme);
+        if (!entry.isEmpty() && entry.first().toLatin1() == stamp && outputsExist(outputs)) {
+            batch->result.unchanged++;
+            continue;
+        }
+
+        // e.g. a template was taken out of [Schemes] Templates, or the Directory moved
+        for (const QString &output : entry.mid(1)) {
+            if (!outputs.contains(output)) {
+                QFile::remove(output);
+            }
+        }
+        batch->schemes.append(scheme);
+        batch->schemeStamps.append(stamp);
+    }
+
+    // uninstalled since the last batch
+    const QStringList stamped = group.keyList();
+    for (const QString &scheme : stamped) {
+        if (installed.contains(scheme)) {
+            continue;
+        }
+        // what it was exported to, and for entries from before those were recorded,
+        // what the current settings would have written
+        QStringList outputs = group.readEntry(scheme, QStringList()).mid(1);
+        outputs.append(outputsOf(request.settings, scheme));
+        for (const QString &output : std::as_const(outputs)) {
+            QFile::remove(output);
+        }
+        group.deleteEntry(scheme);
+        batch->result.removed++;
+    }
+
+    if (batch->schemes.isEmpty()) {
+        // always finish asynchronously, like when there is work to do
+        QMetaObject::invokeMethod(
+            this,
+            [this, batch]() {
+                finish(batch);
+            },
+            Qt::QueuedConnection);
+        return;
+    }
+
+    batch->failed.assign(batch->schemes.size(), 0);
+    batch->remaining = batch->schemes.size();
+    for (qsizetype i = 0; i < batch->schemes.size(); i++) {
+        pool.start([this, batch, i]() {
+            batch->failed[i] = !exportScheme(batch->settings, batch->schemes.at(i));
+
+            if (batch->remaining.fetch_sub(1) == 1) {
+                QMetaObject::invokeMethod(
+                    this,
+                    [this, batch]() {
+                        finish(batch);
+                    },
+                    Qt::QueuedConnection);
+            }
+        });
+    }
+}
+
+void SchemeBatch::finish(const std::shared_ptr<Batch> &batch)
+{
+    KConfigGroup group = stamps->group(QStringLiteral("Stamps"));
+    for (qsizetype i = 0; i < batch->schemes.size(); i++) {
+        const QString &scheme = batch->schemes.at(i);
+        const QStringList outputs = outputsOf(batch->settings, scheme);
+        if (batch->failed[i]) {
+            // no stamp, so it's tried again next time. The outputs are still recorded,
+            // some of them may have been written
+            group.writeEntry(scheme, stampEntry(QByteArray(), outputs));
+            batch->result.failed++;
+        } else {
+            group.writeEntry(scheme, stampEntry(batch->schemeStamps.at(i), outputs));
+            batch->result.exported++;
+        }
+    }
+
+    QDir().mkpath(QFileInfo(stamps->name()).absolutePath());
+    if (!stamps->sync()) {
+        qCWarning(KOLOR_EXPORTER) << "Failed to write" << stamps->name();
+    }
+
+    batch->result.elapsedNanoseconds = batch->timer.nsecsElapsed();
+    running = false;
+    Q_EMIT finished(batch->result);
+
+    if (pending) {
+        const Request request = std::move(*pending);
+        pending.reset();
+        run(request);
+    }
+}
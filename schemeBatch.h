@@ -0,0 +1,65 @@
+#pragma once
+
+#include "exportTarget.h"
+
+#include <QObject>
+#include <QStringList>
+#include <QThreadPool>
+
+#include <KSharedConfig>
+
+#include <memory>
+#include <optional>
+
+// Exports every installed .colors scheme, not only the active one, so apps can
+// switch between them without waiting for kded. Each scheme is its own task on
+// a thread pool, and only the schemes whose file changed since the last run are
+// computed again.
+class SchemeBatch : public QObject
+{
+    Q_OBJECT
+public:
+    struct Result {
+        int exported = 0;
+        int unchanged = 0;
+        int removed = 0;
+        int failed = 0;
+        qint64 elapsedNanoseconds = 0;
+    };
+
+    // stamps remembers which version of every scheme was exported, by default
+    // ~/.cache/kolor-exporter/schemes
+    explicit SchemeBatch(QObject *parent = nullptr);
+    explicit SchemeBatch(const QString &stampsFileName, QObject *parent = nullptr);
+    ~SchemeBatch() override;
+
+    // color-schemes in every data directory
+    static QStringList schemeDirectories();
+    // the .colors files of directories, a file name in an earlier directory hides
+    // the same one in the later ones like QStandardPaths does
+    static QStringList findSchemes(const QStringList &directories);
+
+    // runs in the background, finished() is emitted when done. If a batch is still
+    // running, this one starts after it
+    void start(const SchemeExportSettings &settings, const QStringList &schemes);
+    bool isRunning() const;
+
+Q_SIGNALS:
+    void finished(const SchemeBatch::Result &result);
+
+private:
+    struct Request {
+        SchemeExportSettings settings;
+        QStringList schemes;
+    };
+    struct Batch;
+
+    void run(const Request &request);
+    void finish(const std::shared_ptr<Batch> &batch);
+
+    KSharedConfigPtr stamps;
+    bool running = false;
+    // the latest start() while a batch was running
+    std::optional<Request> pending;
+    QThreadPool pool;
+};
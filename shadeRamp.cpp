@@ -0,0 +1,206 @@
+#include "shadeRamp.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+namespace
+{
+// QColor stores 16 bit channels and converts them to 8 bit like this
+constexpr int div257(int x)
+{
+    return (x - (x >> 8) + 0x80) >> 8;
+}
+
+float toLinear(float c)
+{
+    return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+// 1.055 * c^(1/2.4) - 0.055 fitted on the square, fourth and eighth roots of c, within
+// 3.2e-5 of the exact curve (1/100 of an 8 bit step). Unlike std::pow, std::sqrt has a
+// vector instruction, so the loop calling this vectorizes (see -fno-math-errno in CMakeLists.txt)
+float fromLinear(float c)
+{
+    const float s1 = std::sqrt(c);
+    const float s2 = std::sqrt(s1);
+    const float s3 = std::sqrt(s2);
+    const float curve = 0.6540066593f * s1 + 0.6886710057f * s2 - 0.3184415895f * s3 - 0.0201932456f * c - 0.0040744002f;
+    return c <= 0.0031308f ? c * 12.92f : curve;
+}
+
+int toByte(float c)
+{
+    return int(std::clamp(c, 0.f, 1.f) * 255.f + 0.5f);
+}
+}
+
+ShadeRamp::ShadeRamp(Space space, const QColor &base)
+    : space(space)
+{
+    if (space == Hsl) {
+        // through the 8 bit hue and saturation, like QColor::fromHsl(base.hslHue(), base.hslSaturation(), ...)
+        const int hue = base.hslHue();
+        const int saturation16 = base.hslSaturation() * 0x101;
+        achromatic = hue < 0 || saturation16 == 0;
+        saturation = saturation16 / float(USHRT_MAX);
+
+        const float h = (hue % 360) * 100 / 36000.0f;
+        const float offsets[3] = {h + (1.0f / 3.0f), h, h - (1.0f / 3.0f)};
+        for (int i = 0; i < 3; i++) {
+            float t = offsets[i];
+            if (t < 0.0f) {
+                t += 1.0f;
+            } else if (t > 1.0f) {
+                t -= 1.0f;
+            }
+
+            if (t * 6.0f < 1.0f) {
+                channelCases[i] = Rising;
+                channelFactors[i] = t * 6.0f;
+            } else if (t * 2.0f < 1.0f) {
+                channelCases[i] = Maximum;
+            } else if (t * 3.0f < 2.0f) {
+                channelCases[i] = Falling;
+                channelFactors[i] = 2.0f / 3.0f - t;
+            } else {
+                channelCases[i] = Minimum;
+            }
+        }
+        return;
+    }
+
+    const float r = toLinear(base.redF());
+    const float g = toLinear(base.greenF());
+    const float b = toLinear(base.blueF());
+
+    const float l = std::cbrt(0.4122214708f * r + 0.5363325363f * g + 0.0514459929f * b);
+    const float m = std::cbrt(0.2119034982f * r + 0.6806995451f * g + 0.1073969566f * b);
+    const float s = std::cbrt(0.0883024619f * r + 0.2817188376f * g + 0.6299787005f * b);
+
+    baseLightness = 0.2104542553f * l + 0.7936177850f * m - 0.0040720468f * s;
+    const float labA = 1.9779984951f * l - 2.4285922050f * m + 0.4505937099f * s;
+    const float labB = 0.0259040371f * l + 0.7827717662f * m - 0.8086757660f * s;
+
+    baseChroma = std::hypot(labA, labB);
+    const float hue = std::atan2(labB, labA);
+    hueCos = std::cos(hue);
+    hueSin = std::sin(hue);
+}
+
+void ShadeRamp::generate(std::span<const float> lightness, std::span<QRgb> out) const
+{
+    Q_ASSERT(out.size() >= lightness.size());
+
+    for (std::size_t start = 0; start < lightness.size(); start += BlockSize) {
+        const qsizetype count = qMin<qsizetype>(BlockSize, lightness.size() - start);
+        if (space == Hsl) {
+            generateHsl(lightness.data() + start, out.data() + start, count);
+        } else {
+            generateOklch(lightness.data() + start, out.data() + start, count);
+        }
+    }
+}
+
+void ShadeRamp::generateHsl(const float *lightness, QRgb *out, qsizetype count) const
+{
+    // this follows QColor::toRgb() step by step, including the 16 bit rounding,
+    // so the result is exactly what QColor::fromHslF() would give
+    int lightness16[BlockSize];
+    float l[BlockSize];
+    for (qsizetype i = 0; i < count; i++) {
+        lightness16[i] = qRound(std::clamp(lightness[i], 0.f, 1.f) * USHRT_MAX);
+        l[i] = lightness16[i] / float(USHRT_MAX);
+    }
+
+    if (achromatic) {
+        for (qsizetype i = 0; i < count; i++) {
+            const int gray = div257(lightness16[i]);
+            out[i] = qRgb(gray, gray, gray);
+        }
+        return;
+    }
+
+    float temp1[BlockSize];
+    float temp2[BlockSize];
+    for (qsizetype i = 0; i < count; i++) {
+        temp2[i] = l[i] < 0.5f ? l[i] * (1.0f + saturation) : l[i] + saturation - (l[i] * saturation);
+        temp1[i] = (2.0f * l[i]) - temp2[i];
+    }
+
+    // the case only depends on the hue, so every loop below is branchless
+    int channels[3][BlockSize];
+    for (int c = 0; c < 3; c++) {
+        int *channel = channels[c];
+        const float factor = channelFactors[c];
+        switch (channelCases[c]) {
+        case Rising:
+            for (qsizetype i = 0; i < count; i++) {
+                channel[i] = qRound((temp1[i] + (temp2[i] - temp1[i]) * factor) * USHRT_MAX);
+            }
+            break;
+        case Maximum:
+            for (qsizetype i = 0; i < count; i++) {
+                channel[i] = qRound(temp2[i] * USHRT_MAX);
+            }
+            break;
+        case Falling:
+            for (qsizetype i = 0; i < count; i++) {
+                channel[i] = qRound((temp1[i] + (temp2[i] - temp1[i]) * factor * 6.0f) * USHRT_MAX);
+            }
+            break;
+        case Minimum:
+            for (qsizetype i = 0; i < count; i++) {
+                channel[i] = qRound(temp1[i] * USHRT_MAX);
+            }
+            break;
+        }
+
+        for (qsizetype i = 0; i < count; i++) {
+            // QColor snaps 1 to 0, and a lightness of 0 is always black
+            channel[i] = channel[i] == 1 || lightness16[i] == 0 ? 0 : div257(channel[i]);
+        }
+    }
+
+    for (qsizetype i = 0; i < count; i++) {
+        out[i] = qRgb(channels[0][i], channels[1][i], channels[2][i]);
+    }
+}
+
+void ShadeRamp::generateOklch(const float *lightness, QRgb *out, qsizetype count) const
+{
+    float r[BlockSize];
+    float g[BlockSize];
+    float b[BlockSize];
+
+    for (qsizetype i = 0; i < count; i++) {
+        const float lab = std::clamp(lightness[i], 0.f, 1.f);
+        // full chroma at the base lightness, fading to gray towards white and black
+        // so the lightest and darkest stops stay inside sRGB
+        const float fade = std::min(lab / std::max(baseLightness, 1e-4f), (1.f - lab) / std::max(1.f - baseLightness, 1e-4f));
+        const float chroma = baseChroma * std::clamp(fade, 0.f, 1.f);
+        const float labA = chroma * hueCos;
+        const float labB = chroma * hueSin;
+
+        const float l = lab + 0.3963377774f * labA + 0.2158037573f * labB;
+        const float m = lab - 0.1055613458f * labA - 0.0638541728f * labB;
+        const float s = lab - 0.0894841775f * labA - 1.2914855480f * labB;
+        const float l3 = l * l * l;
+        const float m3 = m * m * m;
+        const float s3 = s * s * s;
+
+        r[i] = 4.0767416621f * l3 - 3.3077115913f * m3 + 0.2309699292f * s3;
+        g[i] = -1.2684380046f * l3 + 2.6097574011f * m3 - 0.3413193965f * s3;
+        b[i] = -0.0041960863f * l3 - 0.7034186147f * m3 + 1.7076147010f * s3;
+    }
+
+    for (qsizetype i = 0; i < count; i++) {
+        r[i] = fromLinear(std::clamp(r[i], 0.f, 1.f));
+        g[i] = fromLinear(std::clamp(g[i], 0.f, 1.f));
+        b[i] = fromLinear(std::clamp(b[i], 0.f, 1.f));
+    }
+
+    for (qsizetype i = 0; i < count; i++) {
+        out[i] = qRgb(toByte(r[i]), toByte(g[i]), toByte(b[i]));
+    }
+}
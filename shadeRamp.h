@@ -0,0 +1,56 @@
+#pragma once
+
+#include <QColor>
+
+#include <array>
+#include <span>
+
+// Shades of a base color, e.g. the brand-* and primary-* variables of the
+// discord palette. Every stop of a ramp is converted in one go: the stops are
+// processed in blocks, one plain float array per channel, so the compiler can
+// vectorize the conversion loops.
+class ShadeRamp
+{
+public:
+    enum Space {
+        // keeps the hue and saturation of the base, same output as QColor::fromHslF()
+        Hsl,
+        // keeps the hue and (faded towards white and black) chroma of the base in OKLCH,
+        // so shades of different hues with the same lightness look equally light
+        Oklch,
+    };
+
+    ShadeRamp(Space space, const QColor &base);
+
+    // lightness of every stop, from 0 (black) to 1 (white), in the ramp's space.
+    // out has to be at least as large as lightness
+    void generate(std::span<const float> lightness, std::span<QRgb> out) const;
+
+private:
+    static constexpr qsizetype BlockSize = 64;
+
+    void generateHsl(const float *lightness, QRgb *out, qsizetype count) const;
+    void generateOklch(const float *lightness, QRgb *out, qsizetype count) const;
+
+    // how QColor computes a channel from the hue, the same for every stop of a ramp
+    enum HslChannelCase : quint8 {
+        Rising,
+        Maximum,
+        Falling,
+        Minimum,
+    };
+
+    Space space;
+
+    // Hsl
+    bool achromatic = false;
+    float saturation = 0;
+    std::array<HslChannelCase, 3> channelCases = {};
+    std::array<float, 3> channelFactors = {};
+
+    // Oklch
+    float baseLightness = 0;
+    float baseChroma = 0;
+    float hueCos = 0;
+    float hueSin = 0;
+};
@@ -0,0 +1,95 @@
+#include "targetRegistry.h"
+#include "kolorExporterDebug.h"
+
+#include <QDir>
+#include <QFileInfo>
+
+TargetRegistry::TargetRegistry(QObject *parent)
+    : QObject(parent)
+{
+    connect(&watch, &KDirWatch::created, this, &TargetRegistry::onDirectoryCreated);
+    connect(&watch, &KDirWatch::deleted, this, &TargetRegistry::onDirectoryDeleted);
+}
+
+void TargetRegistry::setTargets(const QList<ExportTarget> &targets)
+{
+    for (const ExportTarget &target : std::as_const(allTargets)) {
+        if (!target.requiredDirectory.isEmpty()) {
+            watch.removeDir(target.requiredDirectory);
+        }
+    }
+
+    allTargets = targets;
+    available.clear();
+    available.reserve(allTargets.size());
+
+    for (const ExportTarget &target : std::as_const(allTargets)) {
+        if (target.requiredDirectory.isEmpty()) {
+            available.append(true);
+            continue;
+        }
+
+        // the directory doesn't have to exist, KDirWatch tells us when it's created
+        watch.addDir(target.requiredDirectory);
+        available.append(QFileInfo(target.requiredDirectory).isDir());
+    }
+}
+
+const QList<ExportTarget> &TargetRegistry::targets() const
+{
+    return allTargets;
+}
+
+QList<ExportTarget> TargetRegistry::availableTargets() const
+{
+    QList<ExportTarget> targets;
+    targets.reserve(allTargets.size());
+    for (qsizetype i = 0; i < allTargets.size(); i++) {
+        if (available.at(i)) {
+            targets.append(allTargets.at(i));
+        }
+    }
+    return targets;
+}
+
+bool TargetRegistry::isAvailable(const QString &name) const
+{
+    for (qsizetype i = 0; i < allTargets.size(); i++) {
+        if (allTargets.at(i).name == name) {
+            return available.at(i);
+        }
+    }
+    return false;
+}
+
+void TargetRegistry::onDirectoryCreated(const QString &path)
+{
+    if (!QFileInfo(path).isDir()) {
+        return;
+    }
+    const QString directory = QDir::cleanPath(path);
+
+    QList<ExportTarget> appeared;
+    for (qsizetype i = 0; i < allTargets.size(); i++) {
+        if (!available.at(i) && QDir::cleanPath(allTargets.at(i).requiredDirectory) == directory) {
+            available[i] = true;
+            appeared.append(allTargets.at(i));
+            qCDebug(KOLOR_EXPORTER) << "Target" << allTargets.at(i).name << "was installed";
+        }
+    }
+
+    if (!appeared.isEmpty()) {
+        Q_EMIT targetsAppeared(appeared);
+    }
+}
+
+void TargetRegistry::onDirectoryDeleted(const QString &path)
+{
+    const QString directory = QDir::cleanPath(path);
+    for (qsizetype i = 0; i < allTargets.size(); i++) {
+        if (available.at(i) && QDir::cleanPath(allTargets.at(i).requiredDirectory) == directory) {
+            available[i] = false;
+            qCDebug(KOLOR_EXPORTER) << "Target" << allTargets.at(i).name << "was removed";
+        }
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "exportTarget.h"
+
+#include <QList>
+#include <QObject>
+
+#include <KDirWatch>
+
+// Knows which targets can be exported to right now. The RequiredDirectory of
+// every target is watched (KDirWatch falls back to the closest parent that
+// exists), so an app installed later gets its file right away and exports
+// never have to look at the file system to decide where to write.
+class TargetRegistry : public QObject
+{
+    Q_OBJECT
+public:
+    explicit TargetRegistry(QObject *parent = nullptr);
+
+    // checks every RequiredDirectory once and starts watching them
+    void setTargets(const QList<ExportTarget> &targets);
+
+    // every enabled target of kolorexporterrc, installed or not
+    const QList<ExportTarget> &targets() const;
+    // the ones whose RequiredDirectory exists
+    QList<ExportTarget> availableTargets() const;
+    bool isAvailable(const QString &name) const;
+
+Q_SIGNALS:
+    // the RequiredDirectory of these targets was just created
+    void targetsAppeared(const QList<ExportTarget> &targets);
+
+private:
+    void onDirectoryCreated(const QString &path);
+    void onDirectoryDeleted(const QString &path);
+
+    KDirWatch watch;
+    QList<ExportTarget> allTargets;
+    // same order as allTargets
+    QList<bool> available;
+};